@@ -1,5 +1,5 @@
 target_link_libraries(
-     SlideProjector
+     ${TARGET_NAME}
         glad
         glfw3
         pthread
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "_Common.h"
+
+// Axis-aligned bounding boxes over chunks of triangles, which are culled on the CPU against the frustums of the
+// main camera and the projector. The triangles are ordered so that every node covers one contiguous range of indices,
+// so a node which is entirely inside or outside a frustum is drawn as one range without visiting its chunks.
+class BoundingVolumeHierarchy final
+{
+public:
+   // The nodes are written to the mesh cache as they are, so the layout is fixed.
+   struct Node
+   {
+      glm::vec3 Min;
+      uint32_t FirstIndex; // first index of the triangles below this node
+      glm::vec3 Max;
+      uint32_t IndexNum;
+      uint32_t SecondChild; // 0 for a chunk; the first child directly follows its parent
+      uint32_t Padding[3];
+   };
+   static_assert( sizeof( Node ) == 48, "BoundingVolumeHierarchy::Node is stored as it is in the mesh cache." );
+
+   struct Chunk
+   {
+      uint32_t FirstIndex;
+      uint32_t IndexNum;
+   };
+
+   BoundingVolumeHierarchy(const BoundingVolumeHierarchy&) = delete;
+   BoundingVolumeHierarchy(const BoundingVolumeHierarchy&&) = delete;
+   BoundingVolumeHierarchy& operator=(const BoundingVolumeHierarchy&) = delete;
+   BoundingVolumeHierarchy& operator=(const BoundingVolumeHierarchy&&) = delete;
+
+
+   BoundingVolumeHierarchy() = default;
+   ~BoundingVolumeHierarchy() = default;
+
+   // The triangles are split at the median of their centroids along the longest axis until a chunk has at most
+   // MaxChunkTriangleNum of them. The indices are reordered by chunk, and a chunk keeps the order of its triangles,
+   // so an order for the vertex cache survives.
+   void build(const std::vector<glm::vec3>& vertices, std::vector<uint32_t>& indices);
+   void setNodes(const Node* nodes, size_t node_num) { Nodes.assign( nodes, nodes + node_num ); }
+   // The frustums are given in the space of the vertices. Chunks outside the camera are dropped, and the others go to
+   // the projected chunks if the projector can reach them and to the unprojected chunks otherwise.
+   // Neighboring chunks of the same kind are merged into one.
+   void cull(
+      const glm::mat4& camera_view_projection,
+      const glm::mat4& projector_view_projection,
+      std::vector<Chunk>& projected_chunks,
+      std::vector<Chunk>& unprojected_chunks
+   ) const;
+   [[nodiscard]] const std::vector<Node>& getNodes() const { return Nodes; }
+
+private:
+   enum Containment { OUTSIDE = 0, INTERSECTING, INSIDE };
+
+   inline static constexpr uint32_t MaxChunkTriangleNum = 1024;
+
+   std::vector<Node> Nodes;
+
+   uint32_t buildNode(
+      std::vector<uint32_t>& triangles,
+      uint32_t begin,
+      uint32_t end,
+      const std::vector<glm::vec3>& centroids,
+      const std::vector<glm::vec3>& mins,
+      const std::vector<glm::vec3>& maxes
+   );
+   // The planes point inward, in the order of left, right, bottom, top, near and far.
+   static void getFrustumPlanes(const glm::mat4& view_projection, std::array<glm::vec4, 6>& planes);
+   [[nodiscard]] static Containment classify(const Node& node, const glm::vec4* planes, int plane_num);
+   static void appendChunk(std::vector<Chunk>& chunks, const Node& node);
+   void cullNode(
+      uint32_t node_index,
+      Containment camera_containment,
+      Containment projector_containment,
+      const std::array<glm::vec4, 6>& camera_planes,
+      const std::array<glm::vec4, 6>& projector_planes,
+      std::vector<Chunk>& projected_chunks,
+      std::vector<Chunk>& unprojected_chunks
+   ) const;
+};
@@ -23,6 +23,12 @@ public:
    [[nodiscard]] glm::vec3 getCameraPosition() const { return CamPos; }
    [[nodiscard]] const glm::mat4& getViewMatrix() const { return ViewMatrix; }
    [[nodiscard]] const glm::mat4& getProjectionMatrix() const { return ProjectionMatrix; }
+   // The derived matrices are only recomputed when they are read after the view or the projection changed.
+   [[nodiscard]] const glm::mat4& getInverseViewMatrix() const;
+   [[nodiscard]] const glm::mat4& getInverseProjectionMatrix() const;
+   [[nodiscard]] const glm::mat4& getViewProjectionMatrix() const;
+   // Changes whenever the view or the projection changes, so the users can tell if their own products are stale.
+   [[nodiscard]] uint64_t getRevision() const { return Revision; }
    void setMovingState(bool is_moving) { IsMoving = is_moving; }
    void updateCamera();
    void pitch(int angle);
@@ -37,9 +43,13 @@ public:
    void zoomIn();
    void zoomOut();
    void resetCamera();
+   // Places the camera directly, for paths which are scripted instead of driven by the input.
+   void placeCamera(const glm::vec3& cam_position, const glm::vec3& view_reference_position, const glm::vec3& view_up_vector);
    void updateWindowSize(int width, int height);
 
 private:
+   enum DerivedMatrix { INVERSE_VIEW = 1, INVERSE_PROJECTION = 2, VIEW_PROJECTION = 4 };
+
    bool IsMoving;
    int Width;
    int Height;
@@ -57,4 +67,12 @@ private:
    glm::vec3 CamPos;
    glm::mat4 ViewMatrix;
    glm::mat4 ProjectionMatrix;
+   uint64_t Revision;
+   mutable int DirtyMatrices;
+   mutable glm::mat4 InverseViewMatrix;
+   mutable glm::mat4 InverseProjectionMatrix;
+   mutable glm::mat4 ViewProjectionMatrix;
+
+   void setViewChanged();
+   void setProjectionChanged();
 };
\ No newline at end of file
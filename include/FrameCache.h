@@ -0,0 +1,48 @@
+#pragma once
+
+#include "_Common.h"
+
+// Keeps decoded frames in RAM under a memory budget so that short loops and backward scrubbing
+// are served without decoding. The least recently used frames are evicted when the budget is exceeded.
+// It is only touched by the decoder thread.
+class FrameCache final
+{
+public:
+   FrameCache(const FrameCache&) = delete;
+   FrameCache(const FrameCache&&) = delete;
+   FrameCache& operator=(const FrameCache&) = delete;
+   FrameCache& operator=(const FrameCache&&) = delete;
+
+
+   explicit FrameCache(size_t budget_in_bytes = 0);
+   ~FrameCache() = default;
+
+   void setBudget(size_t budget_in_bytes);
+   void clear();
+   [[nodiscard]] bool contains(size_t clip_index, int frame_index) const;
+   [[nodiscard]] bool find(size_t clip_index, int frame_index, cv::Mat& frame, double& clip_timestamp);
+   void insert(size_t clip_index, int frame_index, const cv::Mat& frame, double clip_timestamp);
+   [[nodiscard]] size_t getBudget() const { return Budget; }
+   [[nodiscard]] size_t getUsedBytes() const { return UsedBytes; }
+   [[nodiscard]] size_t getFrameNum() const { return Entries.size(); }
+
+private:
+   struct Entry
+   {
+      cv::Mat Frame;
+      double ClipTimestamp; // presentation time within its own clip in milliseconds
+      std::list<uint64_t>::iterator Recency;
+   };
+
+   size_t Budget;
+   size_t UsedBytes;
+   std::list<uint64_t> RecentlyUsed; // keys ordered from the most to the least recently used
+   std::unordered_map<uint64_t, Entry> Entries;
+
+   [[nodiscard]] static uint64_t getKey(size_t clip_index, int frame_index)
+   {
+      return static_cast<uint64_t>(clip_index) << 32 | static_cast<uint32_t>(frame_index);
+   }
+   [[nodiscard]] static size_t getByteSize(const cv::Mat& frame) { return frame.total() * frame.elemSize(); }
+   cv::Mat evictLeastRecentlyUsed();
+};
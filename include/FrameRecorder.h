@@ -0,0 +1,65 @@
+#pragma once
+
+#include "_Common.h"
+
+// Records the rendered frames without stalling the render thread.
+// Each frame is read into the next pixel-pack buffer of a ring, and a fence marks when the copy is done on the GPU.
+// The buffers are mapped a few frames later, when their fences have long signaled, and the pixels are handed to
+// an encoder thread which converts and writes them to a video file or an image sequence.
+class FrameRecorder final
+{
+public:
+   FrameRecorder(const FrameRecorder&) = delete;
+   FrameRecorder(const FrameRecorder&&) = delete;
+   FrameRecorder& operator=(const FrameRecorder&) = delete;
+   FrameRecorder& operator=(const FrameRecorder&&) = delete;
+
+
+   explicit FrameRecorder(int buffer_num = 3, int queue_size = 8);
+   ~FrameRecorder();
+
+   // An output path with a video extension is written with cv::VideoWriter, any other path is a directory of images.
+   // If frames may be dropped, a frame is skipped when the encoder is behind instead of waiting for it.
+   [[nodiscard]] bool start(const std::string& output_path, int width, int height, double fps, bool can_drop_frames);
+   // Reads the framebuffer which is bound for reading. It has to be called on the thread which owns the context.
+   void capture();
+   void stop();
+   [[nodiscard]] bool isRecording() const { return !PackBuffers.empty(); }
+   [[nodiscard]] const std::string& getOutputPath() const { return OutputPath; }
+   void printStatistics() const;
+
+private:
+   struct PackBuffer
+   {
+      GLuint Buffer;
+      GLsync Fence; // nullptr if the buffer holds no frame
+   };
+
+   const int BufferNum;
+   const int QueueSize;
+   int Width;
+   int Height;
+   bool CanDropFrames;
+   bool IsVideo;
+   bool StopEncoding;
+   std::string OutputPath;
+   std::vector<PackBuffer> PackBuffers;
+   uint64_t WriteIndex; // next buffer to read the framebuffer into
+   uint64_t ReadIndex; // oldest buffer which holds a frame
+   uint64_t CapturedFrameNum;
+   uint64_t ReadbackStallNum; // captures which had to wait for the oldest readback on the GPU
+   uint64_t DroppedFrameNum; // frames skipped because the encoder was behind
+   std::atomic<uint64_t> WrittenFrameNum;
+   std::mutex QueueLock;
+   std::condition_variable FrameQueued;
+   std::condition_variable FrameWritten;
+   std::queue<cv::Mat> EncodingFrames;
+   std::vector<cv::Mat> FreeFrames; // recycled, so the encoder does not allocate per frame
+   cv::VideoWriter Video;
+   std::thread Encoder;
+
+   [[nodiscard]] bool openOutput(double fps);
+   // Maps the oldest buffer, waiting for its fence if it is not signaled yet, and queues its pixels for the encoder.
+   void retireOldestBuffer(bool wait_for_fence);
+   void encode();
+};
@@ -0,0 +1,138 @@
+#pragma once
+
+#include "_Common.h"
+
+// Produces frames on its own thread into a fixed-size single-producer/single-consumer ring of preallocated frames.
+// The render thread only picks up the newest frame which is due and never waits on the producer.
+// Derived sources fill the ring in decode() and share the scheduling, seeking and statistics.
+class FrameSource
+{
+public:
+   // BGR frames are converted by OpenCV. I420 and NV12 frames keep the decoder's planes in one single-channel Mat
+   // of (height * 3 / 2) x width, with the chroma following the luma plane.
+   enum PixelFormat { BGR = 0, I420, NV12 };
+
+   FrameSource(const FrameSource&) = delete;
+   FrameSource(const FrameSource&&) = delete;
+   FrameSource& operator=(const FrameSource&) = delete;
+   FrameSource& operator=(const FrameSource&&) = delete;
+
+
+   explicit FrameSource(int queue_size);
+   virtual ~FrameSource() = default;
+
+   [[nodiscard]] virtual bool open(const std::string& path, cv::Mat& first_frame, bool use_planar_yuv) = 0;
+   virtual void close();
+   [[nodiscard]] const cv::Mat* acquireFrame(double presentation_time_in_ms);
+   // Like acquireFrame(), but blocks until the producer has passed the presentation time or reached the end,
+   // so offline rendering never misses a frame because the producer was slower than the renderer.
+   [[nodiscard]] const cv::Mat* waitForFrame(double presentation_time_in_ms);
+   void releaseFrame();
+   double seekToFrame(int frame_index);
+   double seekToTime(double time_in_ms);
+   void setLooping(bool is_looping) { IsLooping.store( is_looping, std::memory_order_release ); }
+   virtual void printStatistics() const;
+   [[nodiscard]] bool isLooping() const { return IsLooping.load( std::memory_order_acquire ); }
+   [[nodiscard]] bool isOpened() const { return Worker.joinable(); }
+   [[nodiscard]] PixelFormat getPixelFormat() const { return Clip.Format; }
+   [[nodiscard]] int getFrameWidth() const { return Clip.Width; }
+   [[nodiscard]] int getFrameHeight() const { return Clip.Height; }
+   [[nodiscard]] double getFPS() const { return Clip.FPS; }
+   [[nodiscard]] double getFirstFrameTime() const { return Clip.FirstFrameTime; }
+   [[nodiscard]] int getFrameCount() const { return Clip.FrameCount; }
+   [[nodiscard]] double getFrameTime(int frame_index) const { return Clip.getFrameTime( frame_index ); }
+   [[nodiscard]] int getFrameIndex(double time_in_ms) const { return Clip.getFrameIndex( time_in_ms ); }
+   [[nodiscard]] double getClipTime(double presentation_time_in_ms) const
+   {
+      return presentation_time_in_ms - PresentedTimelineOffset;
+   }
+   [[nodiscard]] bool hasReachedEnd() const { return EndOfStream.load( std::memory_order_acquire ) && getQueueDepth() == 0; }
+   [[nodiscard]] int getQueueSize() const { return QueueSize; }
+   [[nodiscard]] int getQueueDepth() const
+   {
+      return static_cast<int>(WriteIndex.load( std::memory_order_acquire ) - ReadIndex.load( std::memory_order_acquire ));
+   }
+   [[nodiscard]] uint64_t getDecodedFrameNum() const { return DecodedFrameNum.load( std::memory_order_relaxed ); }
+   // Mean time of the decodes which were timed, so frames served from a cache or repeated do not count,
+   // or 0 if the source does not measure it.
+   [[nodiscard]] double getMeanDecodeTime() const
+   {
+      const uint64_t timed_frame_num = TimedFrameNum.load( std::memory_order_relaxed );
+      if (timed_frame_num == 0) return 0.0;
+      return static_cast<double>(DecodeTimeInNs.load( std::memory_order_relaxed )) * 1e-6 / static_cast<double>(timed_frame_num);
+   }
+   [[nodiscard]] uint64_t getDroppedFrameNum() const { return DroppedFrameNum.load( std::memory_order_relaxed ); }
+   [[nodiscard]] uint64_t getStalledFrameNum() const { return StalledFrameNum.load( std::memory_order_relaxed ); }
+   [[nodiscard]] uint64_t getStarvedFrameNum() const { return StarvedFrameNum.load( std::memory_order_relaxed ); }
+   [[nodiscard]] uint64_t getPresentedFrameNum() const { return PresentedFrameNum; }
+   [[nodiscard]] uint64_t getRepeatedFrameNum() const { return RepeatedFrameNum; }
+
+protected:
+   struct ClipInfo
+   {
+      PixelFormat Format;
+      int Width;
+      int Height;
+      double FPS;
+      double FirstFrameTime;
+      int FrameCount;
+
+      ClipInfo() : Format( BGR ), Width( 0 ), Height( 0 ), FPS( 30.0 ), FirstFrameTime( 0.0 ), FrameCount( 0 ) {}
+
+      [[nodiscard]] double getFrameTime(int frame_index) const
+      {
+         return FirstFrameTime + static_cast<double>(frame_index) * 1000.0 / FPS;
+      }
+      [[nodiscard]] int getFrameIndex(double time_in_ms) const;
+      [[nodiscard]] int clampFrameIndex(int frame_index) const;
+   };
+
+   const int QueueSize;
+   ClipInfo Clip; // the clip which was opened by open()
+   std::atomic<bool> IsLooping;
+   std::vector<cv::Mat> Frames;
+   std::atomic<uint64_t> WriteIndex; // only written by the producer thread
+   std::atomic<uint64_t> ReadIndex; // only written by the render thread
+   std::atomic<bool> StopDecoding;
+   std::atomic<bool> EndOfStream;
+   std::atomic<uint64_t> DecodedFrameNum;
+   std::atomic<uint64_t> DecodeTimeInNs; // time the producer spent decoding, without waiting for free slots
+   std::atomic<uint64_t> TimedFrameNum; // decodes which DecodeTimeInNs covers
+   std::atomic<uint64_t> StalledFrameNum; // frames the producer had to hold because the ring was full
+
+   // Preallocates the ring for frames like the first one, resets the counters and starts decode() on the worker.
+   // The ring indices begin at first_index, which lets a source line them up with its own sequence numbers.
+   void start(const cv::Mat& first_frame, uint64_t first_index = 0);
+   [[nodiscard]] bool takeSeekRequest(uint32_t& epoch, int& frame_index);
+   [[nodiscard]] bool isRingFull(uint64_t write_index) const
+   {
+      return write_index - ReadIndex.load( std::memory_order_acquire ) >= static_cast<uint64_t>(QueueSize);
+   }
+   // Returns false if the source is closed while waiting.
+   [[nodiscard]] bool waitForFreeSlot(uint64_t write_index);
+   void commitFrame(uint64_t write_index, double timestamp, double timeline_offset, uint32_t epoch);
+   // Safe to call from several decoding threads at once.
+   void addDecodeTime(std::chrono::steady_clock::duration decode_time);
+   // Commits a slot which could not be filled, so the ring keeps its order, but the render thread never presents it.
+   void discardFrame(uint64_t write_index, double timestamp, double timeline_offset)
+   {
+      commitFrame( write_index, timestamp, timeline_offset, DiscardedEpoch );
+   }
+   virtual void decode() = 0;
+
+private:
+   inline static constexpr uint32_t DiscardedEpoch = std::numeric_limits<uint32_t>::max(); // never a seek epoch
+
+   std::vector<double> Timestamps; // presentation time of each slot in milliseconds
+   std::vector<double> TimelineOffsets; // offset of each slot's clip on the playback timeline
+   double PresentedTimelineOffset;
+   std::vector<uint32_t> Epochs; // seek epoch each slot was produced in
+   uint32_t Epoch; // current seek epoch of the render thread
+   std::atomic<uint64_t> SeekRequest; // <epoch, frame index> packed in one word, 0 if there is no request
+   uint64_t AcquiredIndex;
+   std::atomic<uint64_t> DroppedFrameNum; // frames which were already late when the render thread saw them
+   std::atomic<uint64_t> StarvedFrameNum; // rendered frames that found no frame in the ring
+   uint64_t PresentedFrameNum;
+   uint64_t RepeatedFrameNum; // rendered frames that kept the last frame because the next one was not due yet
+   std::thread Worker;
+};
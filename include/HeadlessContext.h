@@ -0,0 +1,28 @@
+#pragma once
+
+#include "_Common.h"
+
+// OpenGL core context without any window or display server, made current with no surface.
+// It is created on a surfaceless EGL display, which Mesa provides for llvmpipe as well as for the GPU drivers,
+// so everything is rendered into framebuffer objects. Without EGL in the build, create() always fails.
+class HeadlessContext final
+{
+public:
+   HeadlessContext(const HeadlessContext&) = delete;
+   HeadlessContext(const HeadlessContext&&) = delete;
+   HeadlessContext& operator=(const HeadlessContext&) = delete;
+   HeadlessContext& operator=(const HeadlessContext&&) = delete;
+
+
+   HeadlessContext();
+   ~HeadlessContext();
+
+   [[nodiscard]] bool create(int major_version, int minor_version);
+   void destroy();
+   [[nodiscard]] bool isCreated() const { return Context != nullptr; }
+   [[nodiscard]] static void* getProcAddress(const char* name);
+
+private:
+   void* Display;
+   void* Context;
+};
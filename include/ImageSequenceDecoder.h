@@ -0,0 +1,40 @@
+#pragma once
+
+#include "FrameSource.h"
+#include "ThreadPool.h"
+
+// Plays a directory of numbered PNG/JPEG/EXR/... frames into the frame ring of FrameSource.
+// Every frame file is memory-mapped and decoded by a thread pool straight into its ring slot, with up to a full ring
+// of frames in flight ahead of the playhead. Frames are committed in order, so the render thread sees a plain video.
+class ImageSequenceDecoder final : public FrameSource
+{
+public:
+   ImageSequenceDecoder(const ImageSequenceDecoder&) = delete;
+   ImageSequenceDecoder(const ImageSequenceDecoder&&) = delete;
+   ImageSequenceDecoder& operator=(const ImageSequenceDecoder&) = delete;
+   ImageSequenceDecoder& operator=(const ImageSequenceDecoder&&) = delete;
+
+
+   explicit ImageSequenceDecoder(double fps = 30.0, int thread_num = 0, int queue_size = 0);
+   ~ImageSequenceDecoder() override;
+
+   // The frames are sorted by the numbers in their file names. They are always decoded to BGR.
+   [[nodiscard]] bool open(const std::string& directory_path, cv::Mat& first_frame, bool use_planar_yuv) override;
+   void printStatistics() const override;
+   [[nodiscard]] uint64_t getFailedFrameNum() const { return FailedFrameNum.load( std::memory_order_relaxed ); }
+
+private:
+   const double FPS;
+   std::vector<std::string> FramePaths;
+   std::atomic<uint64_t> FailedFrameNum;
+   std::unique_ptr<ThreadPool> Decoders;
+
+   [[nodiscard]] static std::vector<std::string> getFramePaths(const std::string& directory_path);
+   // The decode is timed into the statistics of the source if one is given; the first frame is decoded before start().
+   [[nodiscard]] static bool decodeFrame(
+      const std::string& frame_path,
+      cv::Mat& frame,
+      ImageSequenceDecoder* source = nullptr
+   );
+   void decode() override;
+};
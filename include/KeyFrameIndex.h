@@ -0,0 +1,35 @@
+#pragma once
+
+#include "_Common.h"
+
+// Key frames of the video track of an MP4/MOV file, read once from the sync sample table ('stss') of the container.
+// cv::VideoCapture does not expose the key flags of the packets, but the container already lists them,
+// so the index is built without decoding anything. Other containers are left unindexed.
+class KeyFrameIndex final
+{
+public:
+   KeyFrameIndex(const KeyFrameIndex&) = delete;
+   KeyFrameIndex(const KeyFrameIndex&&) = delete;
+   KeyFrameIndex& operator=(const KeyFrameIndex&) = delete;
+   KeyFrameIndex& operator=(const KeyFrameIndex&&) = delete;
+
+
+   KeyFrameIndex();
+   ~KeyFrameIndex() = default;
+
+   // Returns false if the file has no indexable video track, and the index stays empty then.
+   bool build(const std::string& video_path);
+   void clear();
+   [[nodiscard]] bool isBuilt() const { return IsBuilt; }
+   [[nodiscard]] size_t getKeyFrameNum() const { return KeyFrames.size(); }
+   // The last key frame at or before the frame, or -1 if the index is not built.
+   [[nodiscard]] int getPrecedingKeyFrame(int frame_index) const;
+
+private:
+   bool IsBuilt;
+   bool AreAllFramesKey; // a track without a sync sample table has only key frames
+   std::vector<int> KeyFrames; // zero-based frame indices in ascending order
+
+   // Reads the sync samples of the track in [data, end), and returns false if it is not a video track.
+   [[nodiscard]] bool readTrack(const uint8_t* data, const uint8_t* end);
+};
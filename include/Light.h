@@ -2,11 +2,45 @@
 
 #include "Shader.h"
 
+// Owns the light list in a std430 shader storage buffer. Only the lights which were changed since the last
+// transfer are uploaded, so the number of lights is only bounded by the buffer size.
+// The lights are moved into the eye coordinates once per frame and binned into clusters, which are screen tiles cut
+// by exponential depth slices, so a fragment only shades the lights which can reach it. The clusters share one index
+// list, which grows to what they need, so no light is dropped from a crowded cluster.
 class LightGL final
 {
 public:
+   // std430 layout of LightInfo in the shaders
+   struct LightInfo
+   {
+      glm::vec4 Position;
+      glm::vec4 AmbientColor;
+      glm::vec4 DiffuseColor;
+      glm::vec4 SpecularColor;
+      glm::vec3 SpotlightDirection;
+      GLfloat SpotlightCutoffAngle;
+      GLfloat SpotlightFeather;
+      GLfloat FallOffRadius;
+      GLint LightSwitch;
+      GLint Padding;
+   };
+
+   enum { LIGHT_BUFFER_BINDING = 0, VIEW_LIGHT_BUFFER_BINDING, LIGHT_GRID_BINDING, LIGHT_INDEX_BINDING };
+   enum LightCullingShader { TRANSFORM_LIGHTS = 0, COUNT_LIGHTS, OFFSET_LIGHT_LISTS, CULL_LIGHTS };
+
+   inline static constexpr int ClusterNumX = 16;
+   inline static constexpr int ClusterNumY = 9;
+   inline static constexpr int ClusterNumZ = 24;
+   inline static constexpr int ClusterNum = ClusterNumX * ClusterNumY * ClusterNumZ;
+
+   LightGL(const LightGL&) = delete;
+   LightGL(const LightGL&&) = delete;
+   LightGL& operator=(const LightGL&) = delete;
+   LightGL& operator=(const LightGL&&) = delete;
+
+
    LightGL();
-   ~LightGL() = default;
+   ~LightGL();
 
    [[nodiscard]] bool isLightOn() const;
    void toggleLightSwitch();
@@ -22,21 +56,55 @@ public:
    );
    void activateLight(const int& light_index);
    void deactivateLight(const int& light_index);
-   void transferUniformsToShader(const ShaderGL* shader);
+   // Removes the lights from light_num onward.
+   void truncateLights(int light_num);
+   // Uploads the changed lights and binds the buffer to LIGHT_BUFFER_BINDING.
+   void transferLightsToShader();
+   // The culling shader holds LightTransform.comp, LightCulling.comp with COUNT_LIGHTS, LightListOffsets.comp and
+   // LightCulling.comp in the order of LightCullingShader.
+   // The lights in the eye coordinates are always needed; the clusters only when the lights are culled.
+   void transformLightsToView(const ShaderGL* culling_shader) const;
+   void cullLights(const ShaderGL* culling_shader);
+   // Waits for the last culling, so it is only meant for the benchmark.
+   [[nodiscard]] GLuint getLightIndexNum() const;
+   [[nodiscard]] GLuint getLightIndexCapacity() const { return LightIndexCapacity; }
    [[nodiscard]] int getTotalLightNum() const { return TotalLightNum; }
-   [[nodiscard]] glm::vec4 getLightPosition(int light_index) { return Positions[light_index]; }
+   [[nodiscard]] glm::vec4 getLightPosition(int light_index) { return Lights[light_index].Position; }
 
 private:
+   // std430 layout of the header of LightBlock in the shaders
+   struct LightHeader
+   {
+      glm::vec4 GlobalAmbient;
+      GLint UseLight;
+      GLint LightNum;
+      GLint Padding[2];
+   };
+
+   // std430 layout of the header of LightGridBlock in the shaders, which an array of uvec2 per cluster follows
+   struct LightGridHeader
+   {
+      GLuint LightIndexNum;
+      GLuint LightIndexCapacity;
+   };
+
    bool TurnLightOn;
    int TotalLightNum;
    glm::vec4 GlobalAmbientColor;
-   std::vector<bool> IsActivated;
-   std::vector<glm::vec4> Positions;
-   std::vector<glm::vec4> AmbientColors;
-   std::vector<glm::vec4> DiffuseColors;
-   std::vector<glm::vec4> SpecularColors;
-   std::vector<glm::vec3> SpotlightDirections;
-   std::vector<float> SpotlightCutoffAngles;
-   std::vector<float> SpotlightFeathers;
-   std::vector<float> FallOffRadii;
-};
\ No newline at end of file
+   std::vector<LightInfo> Lights;
+   std::vector<bool> IsDirty;
+   bool IsHeaderDirty;
+   GLuint LightBuffer;
+   GLuint ViewLightBuffer;
+   GLuint LightGridBuffer;
+   GLuint LightIndexBuffer;
+   GLuint LightIndexNumBuffer; // a copy of LightIndexNum which is read without waiting for the later frames
+   GLsync LightIndexNumFence; // nullptr if no copy is pending
+   GLuint LightIndexCapacity;
+   int LightCapacity;
+
+   void reallocateLightBuffer();
+   void reallocateLightIndexBuffer(GLuint capacity);
+   // Grows the index list once the GPU has reported that the clusters needed more than it holds.
+   void growLightIndexBuffer();
+};
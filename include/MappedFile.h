@@ -0,0 +1,33 @@
+#pragma once
+
+#include "_Common.h"
+
+// Read-only memory mapping of a whole file, so the file is decoded straight from the page cache without a copy.
+class MappedFile final
+{
+public:
+   MappedFile(const MappedFile&) = delete;
+   MappedFile(const MappedFile&&) = delete;
+   MappedFile& operator=(const MappedFile&) = delete;
+   MappedFile& operator=(const MappedFile&&) = delete;
+
+
+   MappedFile();
+   ~MappedFile();
+
+   [[nodiscard]] bool open(const std::string& file_path);
+   void close();
+   [[nodiscard]] bool isOpened() const { return Data != nullptr; }
+   [[nodiscard]] const uint8_t* getData() const { return Data; }
+   [[nodiscard]] size_t getSize() const { return Size; }
+
+private:
+   const uint8_t* Data;
+   size_t Size;
+#ifdef _WIN32
+   void* FileHandle;
+   void* MappingHandle;
+#else
+   int FileDescriptor;
+#endif
+};
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "MappedFile.h"
+#include "BoundingVolumeHierarchy.h"
+
+// Triangle mesh of an OBJ or PLY file.
+// Parsing text is slow for scanned meshes, so the first load writes a binary cache next to the file: a header page,
+// then the interleaved vertices, the indices and the culling hierarchy over them, each starting on a page boundary.
+// Later loads map the cache and hand the mapped memory to OpenGL as it is.
+// The cache is rebuilt when the size or the time of the mesh file changes.
+class MeshFile final
+{
+public:
+   MeshFile(const MeshFile&) = delete;
+   MeshFile(const MeshFile&&) = delete;
+   MeshFile& operator=(const MeshFile&) = delete;
+   MeshFile& operator=(const MeshFile&&) = delete;
+
+
+   MeshFile();
+   ~MeshFile() = default;
+
+   // Polygons are split into triangle fans. Missing normals are computed from the faces, and missing texture
+   // coordinates are zero.
+   [[nodiscard]] static bool parse(
+      const std::string& mesh_file_path,
+      std::vector<glm::vec3>& vertices,
+      std::vector<glm::vec3>& normals,
+      std::vector<glm::vec2>& textures,
+      std::vector<uint32_t>& indices
+   );
+   [[nodiscard]] static bool writeCache(
+      const std::string& mesh_file_path,
+      const void* vertices,
+      size_t vertex_num,
+      size_t vertex_stride,
+      const std::vector<uint32_t>& indices,
+      const std::vector<BoundingVolumeHierarchy::Node>& nodes
+   );
+   [[nodiscard]] static std::string getCachePath(const std::string& mesh_file_path) { return mesh_file_path + ".spmesh"; }
+   // The cache is only used if it is up to date and was written with the same vertex stride.
+   [[nodiscard]] bool openCache(const std::string& mesh_file_path, size_t vertex_stride);
+   void closeCache();
+   [[nodiscard]] bool isCacheOpened() const { return Header != nullptr; }
+   [[nodiscard]] const void* getVertices() const { return Cache.getData() + Header->VertexOffset; }
+   [[nodiscard]] size_t getVertexNum() const { return static_cast<size_t>(Header->VertexNum); }
+   [[nodiscard]] const void* getIndices() const { return Cache.getData() + Header->IndexOffset; }
+   [[nodiscard]] size_t getIndexNum() const { return static_cast<size_t>(Header->IndexNum); }
+   [[nodiscard]] GLenum getIndexType() const { return static_cast<GLenum>(Header->IndexType); }
+   [[nodiscard]] const BoundingVolumeHierarchy::Node* getNodes() const
+   {
+      return reinterpret_cast<const BoundingVolumeHierarchy::Node*>(Cache.getData() + Header->NodeOffset);
+   }
+   [[nodiscard]] size_t getNodeNum() const { return static_cast<size_t>(Header->NodeNum); }
+
+private:
+   struct CacheHeader
+   {
+      char Magic[8];
+      uint32_t Version;
+      uint32_t VertexStride;
+      uint64_t SourceSize;
+      int64_t SourceTime;
+      uint64_t VertexNum;
+      uint64_t VertexOffset;
+      uint64_t IndexNum;
+      uint64_t IndexOffset;
+      uint32_t IndexType;
+      uint32_t Reserved;
+      uint64_t NodeNum;
+      uint64_t NodeOffset;
+   };
+
+   inline static constexpr char CacheMagic[8] = { 'S', 'P', 'M', 'E', 'S', 'H', '\0', '\0' };
+   inline static constexpr uint32_t CacheVersion = 2;
+   inline static constexpr uint64_t CachePageSize = 4096;
+
+   MappedFile Cache;
+   const CacheHeader* Header;
+
+   [[nodiscard]] static bool getSourceIdentity(const std::string& mesh_file_path, uint64_t& size, int64_t& time);
+   [[nodiscard]] static bool parseOBJ(
+      const char* data,
+      const char* end,
+      std::vector<glm::vec3>& vertices,
+      std::vector<glm::vec3>& normals,
+      std::vector<glm::vec2>& textures,
+      std::vector<uint32_t>& indices
+   );
+   [[nodiscard]] static bool parsePLY(
+      const char* data,
+      const char* end,
+      std::vector<glm::vec3>& vertices,
+      std::vector<glm::vec3>& normals,
+      std::vector<glm::vec2>& textures,
+      std::vector<uint32_t>& indices
+   );
+   // Each vertex gets the area-weighted average of the normals of its faces.
+   static void computeNormals(
+      const std::vector<glm::vec3>& vertices,
+      const std::vector<uint32_t>& indices,
+      std::vector<glm::vec3>& normals
+   );
+};
@@ -1,12 +1,37 @@
 #pragma once
 
 #include "Shader.h"
+#include "VertexFormat.h"
+#include "MeshFile.h"
 
 class ObjectGL
 {
 public:
    enum LayoutLocation { VertexLoc = 0, NormalLoc, TextureLoc };
 
+   // The position always comes first, so replaceVertices() can overwrite it in any of these layouts.
+   using PositionFormat = VertexFormat<VertexAttribute<VertexLoc, Float3Encoding>>;
+   using PositionNormalFormat = VertexFormat<
+      VertexAttribute<VertexLoc, Float3Encoding>,
+      VertexAttribute<NormalLoc, Float3Encoding>
+   >;
+   using PositionTextureFormat = VertexFormat<
+      VertexAttribute<VertexLoc, Float3Encoding>,
+      VertexAttribute<TextureLoc, Float2Encoding>
+   >;
+   using PositionNormalTextureFormat = VertexFormat<
+      VertexAttribute<VertexLoc, Float3Encoding>,
+      VertexAttribute<NormalLoc, Float3Encoding>,
+      VertexAttribute<TextureLoc, Float2Encoding>
+   >;
+   // 20 bytes per vertex instead of 32. The shaders read the same vec3 normal and vec2 texture coordinates.
+   using PackedPositionNormalTextureFormat = VertexFormat<
+      VertexAttribute<VertexLoc, Float3Encoding>,
+      VertexAttribute<NormalLoc, PackedNormalEncoding>,
+      VertexAttribute<TextureLoc, Half2Encoding>
+   >;
+   using MeshFormat = PackedPositionNormalTextureFormat;
+
    ObjectGL();
    ~ObjectGL();
 
@@ -21,6 +46,11 @@ public:
       const std::vector<glm::vec3>& vertices,
       const std::vector<glm::vec3>& normals
    );
+   void setObject(
+      GLenum draw_mode,
+      const std::vector<glm::vec3>& vertices,
+      const std::vector<glm::vec2>& textures
+   );
    void setObject(
       GLenum draw_mode,
       const std::vector<glm::vec3>& vertices,
@@ -48,6 +78,16 @@ public:
       const std::vector<glm::vec2>& textures,
       const cv::Mat& texture
    );
+   // Draws the object with glDrawElements after it is set. The indices are stored in 16 bits if every vertex can be
+   // addressed with them. Triangle lists can be reordered for the post-transform vertex cache, and then the vertices
+   // are also reordered by their first use, so the fetches walk the vertex buffer forward.
+   void setIndices(std::vector<uint32_t> indices, bool optimize_vertex_order = false);
+   // Uploads indices which are already in their final type and order.
+   void setIndices(const void* indices, size_t index_num, GLenum index_type);
+   // Loads triangles from an OBJ or PLY file in MeshFormat. The first load optimizes them for the vertex cache,
+   // groups them into the chunks of a BoundingVolumeHierarchy, and writes the result to the binary cache of MeshFile,
+   // which later loads upload without parsing.
+   [[nodiscard]] bool setMeshObject(const std::string& mesh_file_path);
    void setSquareObject(GLenum draw_mode, bool use_texture = true);
    void setSquareObject(
       GLenum draw_mode,
@@ -58,23 +98,88 @@ public:
    int addTexture(const cv::Mat& texture);
    void addTexture(int width, int height, bool is_grayscale = false);
    int addTexture(const uint8_t* image_buffer, int width, int height, bool is_grayscale = false);
-   void transferUniformsToShader(const ShaderGL* shader);
+   void transferUniformsToBlock(ShaderGL::ObjectUniformBlock& block) const;
    void updateDataBuffer(const std::vector<glm::vec3>& vertices, const std::vector<glm::vec3>& normals);
    void updateDataBuffer(
       const std::vector<glm::vec3>& vertices,
       const std::vector<glm::vec3>& normals,
       const std::vector<glm::vec2>& textures
    );
-   void replaceVertices(const std::vector<glm::vec3>& vertices, bool normals_exist, bool textures_exist);
-   void replaceVertices(const std::vector<float>& vertices, bool normals_exist, bool textures_exist);
+   void replaceVertices(const std::vector<glm::vec3>& vertices);
+   void replaceVertices(const std::vector<float>& vertices);
    void reallocateTexture(const cv::Mat& texture, int index);
+   void reallocateTexture(int width, int height, GLenum internal_format, int index);
    void updateTexture(const cv::Mat& texture, int index) const;
+   void updateTexture(const uint8_t* image_buffer, int width, int height, GLenum format, int index) const;
+   // The upload which the streaming path replaced, kept to measure against it: every frame is flipped into a new Mat
+   // and uploaded from client memory as GL_BGR, so the driver converts it into the GL_RGBA8 texture.
+   void updateTextureWithFlip(const cv::Mat& texture, int index) const;
+   void prepareStreamingTexture(int index, int width, int height, GLenum format, int buffer_num = 3);
+   [[nodiscard]] uint8_t* mapStreamingTexture(int index);
+   void commitStreamingTexture(int index);
+   void streamTexture(const cv::Mat& texture, int index);
+   void streamTexture(const uint8_t* image_buffer, int index);
+   // Bytes which the CPU read and wrote to upload textures; a copy into the streaming buffer or by the driver
+   // counts as both reading and writing the image once.
+   [[nodiscard]] size_t getUploadedByteNum() const { return UploadedByteNum; }
+   void resetUploadedByteNum() { UploadedByteNum = 0; }
    [[nodiscard]] GLuint getVAO() const { return VAO; }
    [[nodiscard]] GLenum getDrawMode() const { return DrawMode; }
    [[nodiscard]] GLsizei getVertexNum() const { return VerticesCount; }
+   [[nodiscard]] GLsizei getVertexStride() const { return VertexStride; }
+   [[nodiscard]] bool isIndexed() const { return EBO != 0; }
+   [[nodiscard]] GLsizei getIndexNum() const { return IndicesCount; }
+   [[nodiscard]] GLenum getIndexType() const { return IndexType; }
+   // Only meshes have a hierarchy; the culled chunks are ranges of the indices of the object.
+   [[nodiscard]] const BoundingVolumeHierarchy* getBoundingVolumeHierarchy() const { return BVH.get(); }
    [[nodiscard]] GLuint getTextureID(int index) const { return TextureID[index]; }
    [[nodiscard]] int getTextureNum() const { return static_cast<int>(TextureID.size()); }
 
+   // Every source holds one attribute of Format for all vertices, and they are interleaved in one pass
+   // into a buffer which is allocated once.
+   template<typename Format, typename PositionType, typename... SourceTypes>
+   void setVertices(
+      GLenum draw_mode,
+      const std::vector<PositionType>& vertices,
+      const std::vector<SourceTypes>&... sources
+   )
+   {
+      assert( ((sources.size() == vertices.size()) && ...) );
+
+      DrawMode = draw_mode;
+      VerticesCount = static_cast<GLsizei>(vertices.size());
+      DataBuffer.resize( Format::Stride * vertices.size() );
+      Format::interleave( DataBuffer.data(), vertices.size(), vertices.data(), sources.data()... );
+      prepareVertexBuffer( static_cast<GLsizei>(Format::Stride), DataBuffer.data() );
+      Format::setAttributes( VAO, 0 );
+   }
+
+   // The vertices are already interleaved in Format, so they are uploaded straight from the given memory
+   // without a copy on this side. The object keeps no CPU copy of them then, so replaceVertices() does not apply,
+   // and setIndices() reorders only the triangles, not the vertices.
+   template<typename Format>
+   void setInterleavedVertices(GLenum draw_mode, const void* vertices, size_t vertex_num)
+   {
+      DrawMode = draw_mode;
+      VerticesCount = static_cast<GLsizei>(vertex_num);
+      DataBuffer.clear();
+      DataBuffer.shrink_to_fit();
+      prepareVertexBuffer( static_cast<GLsizei>(Format::Stride), vertices );
+      Format::setAttributes( VAO, 0 );
+   }
+
+   // The vertices should have been set in the same Format.
+   template<typename Format, typename PositionType, typename... SourceTypes>
+   void updateVertices(const std::vector<PositionType>& vertices, const std::vector<SourceTypes>&... sources)
+   {
+      assert( VBO != 0 && static_cast<GLsizei>(Format::Stride) == VertexStride );
+      assert( vertices.size() <= static_cast<size_t>(VerticesCount) );
+
+      DataBuffer.resize( Format::Stride * static_cast<size_t>(VerticesCount) );
+      Format::interleave( DataBuffer.data(), vertices.size(), vertices.data(), sources.data()... );
+      glNamedBufferSubData( VBO, 0, static_cast<GLsizeiptr>(Format::Stride * vertices.size()), DataBuffer.data() );
+   }
+
    template<typename T>
    void addShaderStorageBufferObject(const std::string& name, GLuint binding_index, int data_size)
    {
@@ -110,14 +215,39 @@ public:
    }
 
 private:
+   // Pixel-unpack buffer ring which is persistently mapped, so the next frame can be written
+   // while the GPU is still reading the previous ones. Each slot is guarded by its own fence.
+   struct StreamingBuffer
+   {
+      GLuint Buffer;
+      uint8_t* MappedData;
+      GLsizeiptr SlotSize;
+      GLsizei Width;
+      GLsizei Height;
+      GLenum Format;
+      int RowSize;
+      int Current;
+      std::vector<GLsync> Fences;
+
+      StreamingBuffer() : Buffer( 0 ), MappedData( nullptr ), SlotSize( 0 ), Width( 0 ), Height( 0 ), Format( 0 ),
+      RowSize( 0 ), Current( 0 ) {}
+   };
+
    uint8_t* ImageBuffer;
-   std::vector<GLfloat> DataBuffer;
+   std::vector<uint8_t> DataBuffer; // interleaved vertices, empty if they were uploaded without a copy
    GLuint VAO;
    GLuint VBO;
+   GLuint EBO;
    GLenum DrawMode;
+   GLenum IndexType;
+   GLsizei IndicesCount;
    std::vector<GLuint> TextureID;
    std::map<std::string, GLuint> CustomBuffers;
+   std::map<int, StreamingBuffer> StreamingBuffers; // <texture index, streaming buffer>
+   std::unique_ptr<BoundingVolumeHierarchy> BVH;
+   mutable size_t UploadedByteNum;
    GLsizei VerticesCount;
+   GLsizei VertexStride;
    glm::vec4 EmissionColor;
    glm::vec4 AmbientReflectionColor; // It is usually set to the same color with DiffuseReflectionColor.
                                      // Otherwise, it should be in balance with DiffuseReflectionColor.
@@ -126,10 +256,14 @@ private:
    float SpecularReflectionExponent;
 
    [[nodiscard]] bool prepareTexture2DUsingFreeImage(const std::string& file_path, bool is_grayscale) const;
-   void prepareTexture2DFromMat(const cv::Mat& texture) const;
-   void prepareTexture(bool normals_exist) const;
-   void prepareVertexBuffer(int n_bytes_per_vertex);
-   void prepareNormal() const;
+   static void prepareTexture2DFromMat(GLuint texture_id, const cv::Mat& texture);
+   static void uploadTexture2DFromMat(GLuint texture_id, const cv::Mat& texture);
+   static void getTextureFormat(const cv::Mat& texture, GLenum& internal_format, GLenum& format);
+   void prepareVertexBuffer(GLsizei stride, const void* data);
+   void reorderVerticesByFirstUse(std::vector<uint32_t>& indices);
+   void releaseStreamingTexture(int index);
+   [[nodiscard]] bool recreateTexture(int index);
+   [[nodiscard]] static int getBytesPerPixel(GLenum format);
    static void getSquareObject(
       std::vector<glm::vec3>& vertices,
       std::vector<glm::vec3>& normals,
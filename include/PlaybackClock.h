@@ -0,0 +1,23 @@
+#pragma once
+
+#include "_Common.h"
+
+// Wall clock of the video timeline in milliseconds. It decides which decoded frame is due for each rendered frame.
+class PlaybackClock final
+{
+public:
+   PlaybackClock();
+   ~PlaybackClock() = default;
+
+   void start(double start_time_in_ms = 0.0);
+   void pause();
+   void resume();
+   [[nodiscard]] bool isPaused() const { return IsPaused; }
+   [[nodiscard]] double getTime() const;
+
+private:
+   bool IsPaused;
+   double StartTime;
+   double PausedTime;
+   std::chrono::steady_clock::time_point StartPoint;
+};
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "_Common.h"
+
+// Records how long the sections of each frame take on the CPU and, for sections which issue GL commands, on the GPU.
+// The GPU times come from GL_TIME_ELAPSED queries whose results are only collected a few frames later, once
+// they are available, so profiling never waits for the GPU. The latest events are kept in a ring buffer which
+// can be exported as a Chrome trace (chrome://tracing, Perfetto) or as CSV.
+class ProfilerGL final
+{
+public:
+   // Times its section for as long as it is in scope. GPU-timed sections must not nest, as time-elapsed queries cannot.
+   class Scope final
+   {
+   public:
+      Scope(const Scope&) = delete;
+      Scope(const Scope&&) = delete;
+      Scope& operator=(const Scope&) = delete;
+      Scope& operator=(const Scope&&) = delete;
+
+
+      Scope(ProfilerGL* profiler, const char* name, bool is_gpu_timed = false);
+      ~Scope();
+
+   private:
+      ProfilerGL* Profiler;
+      const char* Name;
+      GLuint Query;
+      int64_t StartTimeInUs;
+   };
+
+   ProfilerGL(const ProfilerGL&) = delete;
+   ProfilerGL(const ProfilerGL&&) = delete;
+   ProfilerGL& operator=(const ProfilerGL&) = delete;
+   ProfilerGL& operator=(const ProfilerGL&&) = delete;
+
+
+   explicit ProfilerGL(int event_capacity = 8192, int query_latency = 3);
+   ~ProfilerGL();
+
+   void setEnabled(bool is_enabled);
+   [[nodiscard]] bool isEnabled() const { return IsEnabled; }
+   // Collects the GPU times which have become available and advances the frame the next sections belong to.
+   void endFrame();
+   void printStatistics() const;
+   [[nodiscard]] bool exportChromeTrace(const std::string& file_path) const;
+   [[nodiscard]] bool exportCSV(const std::string& file_path) const;
+
+private:
+   struct Event
+   {
+      const char* Name;
+      uint64_t Frame;
+      int64_t StartTimeInUs; // CPU time since the profiler was created
+      int64_t CPUDurationInUs;
+      int64_t GPUDurationInNs; // -1 if the section is not GPU-timed or its result is still pending
+   };
+
+   struct PendingQuery
+   {
+      GLuint Query;
+      uint64_t EventIndex;
+      uint64_t Frame;
+   };
+
+   bool IsEnabled;
+   const int QueryLatency;
+   uint64_t Frame;
+   uint64_t EventNum; // events recorded so far; the ring keeps the last Events.size() of them
+   std::vector<Event> Events;
+   std::deque<PendingQuery> PendingQueries;
+   std::vector<GLuint> FreeQueries;
+   const std::chrono::steady_clock::time_point BaseTime;
+
+   [[nodiscard]] int64_t getTimeInUs() const;
+   [[nodiscard]] GLuint acquireQuery();
+   void recordEvent(const char* name, int64_t start_time_in_us, int64_t end_time_in_us, GLuint query);
+   // Reads the finished queries in order. With wait_for_results, every pending query is waited for.
+   void collectQueryResults(bool wait_for_results);
+   // Calls the visitor with the events in the ring from the oldest to the newest.
+   void forEachEvent(const std::function<void(const Event&)>& visitor) const;
+};
@@ -11,42 +11,107 @@
 
 #include "_Common.h"
 #include "Light.h"
+#include "HeadlessContext.h"
 #include "Object.h"
+#include "ShaderFileWatcher.h"
+#include "FrameRecorder.h"
+#include "Profiler.h"
+#include "VideoDecoder.h"
+#include "ImageSequenceDecoder.h"
+#include "SharedMemorySource.h"
+#include "PlaybackClock.h"
 
 class RendererGL
 {
 public:
+   enum SlideType { STILL_IMAGE = 0, VIDEO, IMAGE_SEQUENCE, LIVE };
+
+   // Headless rendering draws into an offscreen framebuffer without a display and writes every frame
+   // to a video file if the output path has a video extension, or to an image sequence in that directory otherwise.
+   struct Options
+   {
+      bool IsHeadless;
+      int Width;
+      int Height;
+      SlideType Slide;
+      int FrameNum; // 0 renders a moving slide once to its end
+      double FPS; // 0 follows the frame rate of the slide
+      std::string OutputPath;
+      std::string MeshPath; // OBJ or PLY file which replaces the built-in wall as the projection target
+
+      Options() : IsHeadless( false ), Width( 1920 ), Height( 1080 ), Slide( VIDEO ), FrameNum( 0 ), FPS( 0.0 ) {}
+   };
+
    RendererGL(const RendererGL&) = delete;
    RendererGL(const RendererGL&&) = delete;
    RendererGL& operator=(const RendererGL&) = delete;
    RendererGL& operator=(const RendererGL&&) = delete;
 
 
-   RendererGL();
+   explicit RendererGL(const Options& options);
    ~RendererGL() = default;
 
+   [[nodiscard]] static bool parseArguments(int argc, char** argv, Options& options);
    void play();
+   // Renders a scripted camera and projector path for a fixed number of frames without any input,
+   // and reports the frame, GPU, decode and upload times as JSON to the file or to the standard output.
+   [[nodiscard]] bool benchmark(const std::string& report_path, bool use_generated_slide, bool use_legacy_upload);
 
 private:
    enum WhichObject { WALL = 0, SCREEN, PROJECTOR };
+   enum SlideTextureIndex { VIDEO0 = 0, VIDEO1, VIDEO2, IMAGE };
+   // Each bit is a feature define of SlideProjector.vert and .frag, and each pass draws with its own variant.
+   enum ShaderPermutation : uint32_t {
+      FLAT_COLOR = 0,
+      PROJECT_SLIDE = 1u << 0,
+      USE_LIGHTING = 1u << 1,
+      SAMPLE_SLIDE = 1u << 2,
+      LIT_WALL = PROJECT_SLIDE | USE_LIGHTING
+   };
 
    inline static RendererGL* Renderer = nullptr;
+   const Options Settings;
    GLFWwindow* Window;
+   std::unique_ptr<HeadlessContext> Context; // destroyed after every member which owns OpenGL objects
+   GLuint OffscreenFramebuffer;
+   GLuint OffscreenColorBuffer;
+   GLuint OffscreenDepthBuffer;
    int FrameWidth;
    int FrameHeight;
-   bool IsVideo;
+   SlideType CurrentSlideType;
+   SlideType DecoderType;
+   bool UsePlanarYUV;
+   bool UseGeneratedSlide; // the benchmark can project a synthetic slide instead of decoding one
+   bool UseLegacyUpload; // the benchmark can upload BGR slides the way they were before the streaming path
+   bool UseLightCulling;
+   bool AreObjectBlocksDirty;
+   uint64_t MainCameraRevision; // revisions of the cameras which ObjectBlocks were computed with
+   uint64_t ProjectorRevision;
+   FrameSource::PixelFormat SlideFormat;
+   std::array<ShaderGL::ObjectUniformBlock, PROJECTOR + 1> ObjectBlocks;
+   std::vector<BoundingVolumeHierarchy::Chunk> ProjectedWallChunks;
+   std::vector<BoundingVolumeHierarchy::Chunk> UnprojectedWallChunks;
    cv::Mat Slide;
-   cv::VideoCapture Video;
+   cv::Mat StillImage;
    glm::ivec2 ClickedPoint;
    std::unique_ptr<CameraGL> MainCamera;
    std::unique_ptr<CameraGL> Projector;
    std::unique_ptr<ShaderGL> ObjectShader;
+   std::unique_ptr<ShaderGL> LightCullingShader;
+   std::unique_ptr<ShaderFileWatcher> ShaderWatcher;
    std::unique_ptr<ObjectGL> ProjectorPyramidObject;
    std::unique_ptr<ObjectGL> ScreenObject;
    std::unique_ptr<ObjectGL> WallObject;
    std::unique_ptr<LightGL> Lights;
+   std::unique_ptr<FrameSource> Decoder;
+   std::unique_ptr<PlaybackClock> Clock;
+   std::unique_ptr<FrameRecorder> Recorder;
+   std::unique_ptr<ProfilerGL> Profiler;
  
    void registerCallbacks() const;
+   [[nodiscard]] bool createContext();
+   [[nodiscard]] bool createOffscreenFramebuffer();
+   void deleteOffscreenFramebuffer();
    void initialize();
 
    static void printOpenGLInformation();
@@ -66,16 +131,35 @@ private:
    static void mousewheelWrapper(GLFWwindow* window, double xoffset, double yoffset);
    static void reshapeWrapper(GLFWwindow* window, int width, int height);
 
+   [[nodiscard]] bool hasContext() const { return Window != nullptr || Context->isCreated(); }
+   [[nodiscard]] bool isMovingSlide() const { return CurrentSlideType != STILL_IMAGE; }
+   [[nodiscard]] static std::unique_ptr<FrameSource> createDecoder(SlideType type);
    void prepareSlide();
+   void allocateSlideTextures(int width, int height) const;
+   void uploadSlide(const cv::Mat& frame) const;
+   void seekVideo(double time_in_ms) const;
    void setNextSlide();
+   static void generateSlide(cv::Mat& slide, int frame_index);
+   void updateShaders() const;
 
    void setLights() const;
    void setWallObject() const;
    void setScreenObject();
    void setProjectorPyramidObject() const;
 
-   void drawWallObject() const;
+   static void drawObject(const ObjectGL* object);
+   static void drawObjectChunks(const ObjectGL* object, const std::vector<BoundingVolumeHierarchy::Chunk>& chunks);
+   void drawWallObject();
    void drawScreenObject() const;
    void drawProjectorObject() const;
-   void render() const;
+   void transferSlideToShader() const;
+   void transferUniformBlocks();
+   void transferLightsToShader() const;
+   void render();
+   void toggleRecording();
+   void toggleProfiler() const;
+   void playOffscreen();
+   void benchmarkLights();
+   void moveCamerasAlongPath(float progress) const;
+   [[nodiscard]] static std::string getTimeStatistics(std::vector<double> times_in_ms);
 };
\ No newline at end of file
@@ -6,28 +6,36 @@
 class ShaderGL
 {
 public:
-   struct LightLocationSet
-   {
-      GLint LightSwitch, LightPosition;
-      GLint LightAmbient, LightDiffuse, LightSpecular, LightFallOffRadius;
-      GLint SpotlightDirection, SpotlightCutoffAngle, SpotlightFeather;
+   // std140 layouts of the uniform blocks which are declared the same in every shader stage.
+   // The frame block is written once per frame, and each drawn object has its own slice of one buffer.
+   enum UniformBlockBinding { FRAME_BLOCK = 0, OBJECT_BLOCK };
 
-      LightLocationSet() : LightSwitch( 0 ), LightPosition( 0 ), LightAmbient( 0 ), LightDiffuse( 0 ),
-      LightSpecular( 0 ), LightFallOffRadius( 0 ), SpotlightDirection( 0 ), SpotlightCutoffAngle( 0 ),
-      SpotlightFeather( 0 ) {}
+   struct FrameUniformBlock
+   {
+      glm::mat4 ViewMatrix;
+      glm::mat4 ProjectionMatrix;
+      GLint SlideFormat;
+      GLint Padding[3];
+      glm::mat4 InverseProjectionMatrix;
+      glm::ivec4 LightCluster; // xyz: cluster counts, w: 1 if the lights are culled per cluster
+      glm::vec4 ClusterDepth; // near, far, slice scale and slice bias of log(-z)
+      glm::vec4 Viewport; // width, height, tile width and tile height in pixels
    };
 
-   struct LocationSet
+   struct ObjectUniformBlock
    {
-      GLint World, View, Projection, ModelViewProjection;
-      GLint MaterialEmission, MaterialAmbient, MaterialDiffuse, MaterialSpecular, MaterialSpecularExponent;
-      std::map<GLint, GLint> Texture; // <binding point, texture id>
-      GLint UseTexture, UseLight, LightNum, GlobalAmbient;
-      std::vector<LightLocationSet> Lights;
-
-      LocationSet() : World( 0 ), View( 0 ), Projection( 0 ), ModelViewProjection( 0 ), MaterialEmission( 0 ),
-      MaterialAmbient( 0 ), MaterialDiffuse( 0 ), MaterialSpecular( 0 ), MaterialSpecularExponent( 0 ),
-      UseTexture( 0 ), UseLight( 0 ), LightNum( 0 ), GlobalAmbient( 0 ) {}
+      glm::mat4 ModelViewMatrix;
+      glm::mat4 ModelViewProjectionMatrix;
+      glm::mat4 NormalMatrix; // inverse transpose of the model-view matrix
+      glm::mat4 ProjectorTextureMatrix; // from the object to the homogeneous slide coordinates, top row first
+      glm::vec4 EmissionColor;
+      glm::vec4 AmbientColor;
+      glm::vec4 DiffuseColor;
+      glm::vec4 SpecularColor;
+      GLfloat SpecularExponent;
+      GLfloat MaterialPadding[3];
+      GLint UseTexture;
+      GLint Padding[3];
    };
 
    ShaderGL();
@@ -40,67 +48,125 @@ public:
       const char* tessellation_control_shader_path = nullptr,
       const char* tessellation_evaluation_shader_path = nullptr
    );
-   void setComputeShaders(const std::vector<const char*>& compute_shader_paths);
-   void setUniformLocations(int light_num);
-   void addUniformLocation(const std::string& name);
-   void addUniformLocationToComputeShader(const std::string& name, int shader_index);
-   void transferBasicTransformationUniforms(const glm::mat4& to_world, const CameraGL* camera, bool use_texture = false) const;
+   // The set functions only submit the programs, so the driver can compile all of them in parallel with
+   // GL_KHR_parallel_shader_compile; waitForPendingPrograms() has to be called before they are used.
+   // Compiles one program per key from the same sources. The bit i of a key injects "#define feature_defines[i]"
+   // after the version line, so each variant only contains the code of its features.
+   void setShaderPermutations(
+      const char* vertex_shader_path,
+      const char* fragment_shader_path,
+      const std::vector<std::string>& feature_defines,
+      const std::vector<uint32_t>& permutation_keys
+   );
+   // A shader may be listed more than once with different defines; an empty define adds nothing.
+   void setComputeShaders(
+      const std::vector<const char*>& compute_shader_paths,
+      const std::vector<std::string>& shader_defines = std::vector<std::string>()
+   );
+   // Linked programs are kept as driver binaries in the directory and reused when the sources and the driver match.
+   static void setProgramCacheDirectory(const std::string& directory_path) { ProgramCacheDirectory = directory_path; }
+   static void printProgramCacheStatistics();
+   // Lets the driver compile on its own threads if it supports GL_KHR_parallel_shader_compile.
+   static void initializeParallelCompilation(GLADloadproc get_proc_address);
+   [[nodiscard]] static bool supportsParallelCompilation() { return SupportsParallelCompilation; }
+   void waitForPendingPrograms();
+   // Resubmits every program from its files. The current programs stay in use until updatePendingPrograms()
+   // finds all the new ones compiled, which does not block with the parallel compilation.
+   // A program which fails to link is dropped and the previous one is kept.
+   void reloadShaders();
+   [[nodiscard]] bool updatePendingPrograms();
+   void setUniformBlocks(int object_num);
+   void updateFrameUniformBlock(const FrameUniformBlock& frame);
+   void updateObjectUniformBlocks(const ObjectUniformBlock* objects, int object_num);
+   void bindObjectUniformBlock(int object_index) const;
+   static void getBasicTransformationBlock(
+      ObjectUniformBlock& block,
+      const glm::mat4& to_world,
+      const CameraGL* camera,
+      bool use_texture = false
+   );
    [[nodiscard]] GLuint getShaderProgram() const { return ShaderProgram; }
-   [[nodiscard]] GLint getLocation(const std::string& name) const { return CustomLocations.find( name )->second; }
-   [[nodiscard]] GLint getMaterialEmissionLocation() const { return Location.MaterialEmission; }
-   [[nodiscard]] GLint getMaterialAmbientLocation() const { return Location.MaterialAmbient; }
-   [[nodiscard]] GLint getMaterialDiffuseLocation() const { return Location.MaterialDiffuse; }
-   [[nodiscard]] GLint getMaterialSpecularLocation() const { return Location.MaterialSpecular; }
-   [[nodiscard]] GLint getMaterialSpecularExponentLocation() const { return Location.MaterialSpecularExponent; }
-   [[nodiscard]] GLint getLightAvailabilityLocation() const { return Location.UseLight; }
-   [[nodiscard]] GLint getLightNumLocation() const { return Location.LightNum; }
-   [[nodiscard]] GLint getGlobalAmbientLocation() const { return Location.GlobalAmbient; }
-   [[nodiscard]] GLint getLightSwitchLocation(int light_index) const
-   {
-      return Location.Lights[light_index].LightSwitch;
-   }
-   [[nodiscard]] GLint getLightPositionLocation(int light_index) const
-   {
-      return Location.Lights[light_index].LightPosition;
-   }
-   [[nodiscard]] GLint getLightAmbientLocation(int light_index) const
-   {
-      return Location.Lights[light_index].LightAmbient;
-   }
-   [[nodiscard]] GLint getLightDiffuseLocation(int light_index) const
-   {
-      return Location.Lights[light_index].LightDiffuse;
-   }
-   [[nodiscard]] GLint getLightSpecularLocation(int light_index) const
+   // Returns 0 if the permutation was not requested when the shaders were set up.
+   [[nodiscard]] GLuint getShaderProgram(uint32_t permutation_key) const;
+   [[nodiscard]] GLuint getComputeShaderProgram(int shader_index) const { return ComputeShaderPrograms[shader_index]; }
+
+protected:
+   GLuint ShaderProgram;
+   std::vector<GLuint> ComputeShaderPrograms;
+   std::unordered_map<uint32_t, GLuint> PermutationPrograms;
+   GLuint UniformBlockBuffer;
+   GLsizeiptr ObjectBlockOffset;
+   GLsizeiptr ObjectBlockStride;
+   std::vector<uint8_t> UniformBlockData;
+
+   enum ProgramType { BASIC_PROGRAM = 0, PERMUTATION_PROGRAM, COMPUTE_PROGRAM };
+
+   struct StageSource
    {
-      return Location.Lights[light_index].LightSpecular;
-   }
-   [[nodiscard]] GLint getLightSpotlightDirectionLocation(int light_index) const
+      GLenum Type;
+      std::string Source;
+   };
+
+   struct ProgramRecipe
    {
-      return Location.Lights[light_index].SpotlightDirection;
-   }
-   [[nodiscard]] GLint getLightSpotlightCutoffAngleLocation(int light_index) const
+      ProgramType Type;
+      uint32_t Key; // the permutation key or the index of the compute shader
+      std::vector<std::pair<GLenum, std::string>> ShaderPaths;
+      std::string Defines;
+   };
+
+   struct PendingProgram
    {
-      return Location.Lights[light_index].SpotlightCutoffAngle;
-   }
-   [[nodiscard]] GLint getLightSpotlightFeatherLocation(int light_index) const
+      ProgramType Type;
+      uint32_t Key;
+      GLuint Program;
+      std::vector<std::pair<GLenum, GLuint>> Shaders; // empty if the program was loaded from the cache
+      std::string CachePath;
+      uint64_t SourceHash;
+      bool IsLoadedFromCache;
+      std::chrono::steady_clock::time_point SubmittedTime;
+   };
+
+   // One cache file per recipe, so an edited source overwrites its binary instead of leaving the old one behind.
+   struct ProgramCacheHeader
    {
-      return Location.Lights[light_index].SpotlightFeather;
-   }
-   [[nodiscard]] GLint getLightFallOffRadiusLocation(int light_index) const
+      uint64_t SourceHash;
+      GLenum BinaryFormat;
+      GLsizei BinaryLength;
+   };
+
+   struct ProgramCacheStatistics
    {
-      return Location.Lights[light_index].LightFallOffRadius;
-   }
+      int HitNum, MissNum;
+      double HitTimeInMs;
+      double MissTimeInMs; // includes the compilation, the link and writing the binary
 
-protected:
-   GLuint ShaderProgram;
-   LocationSet Location;
-   std::unordered_map<std::string, GLint> CustomLocations;
-   std::vector<GLuint> ComputeShaderPrograms;
+      ProgramCacheStatistics() : HitNum( 0 ), MissNum( 0 ), HitTimeInMs( 0.0 ), MissTimeInMs( 0.0 ) {}
+   };
+
+   std::vector<ProgramRecipe> ProgramRecipes;
+   std::vector<PendingProgram> PendingPrograms;
+   inline static bool SupportsParallelCompilation = false;
+   inline static std::string ProgramCacheDirectory;
+   inline static ProgramCacheStatistics ProgramCache;
 
    static void readShaderFile(std::string& shader_contents, const char* shader_path);
    [[nodiscard]] static std::string getShaderTypeString(GLenum shader_type);
    [[nodiscard]] static bool checkCompileError(GLenum shader_type, GLuint shader);
-   [[nodiscard]] static GLuint getCompiledShader(GLenum shader_type, const char* shader_path);
-   void setBasicTransformationUniforms();
+   [[nodiscard]] static bool checkLinkError(GLuint program);
+   [[nodiscard]] static std::string getShaderSource(const char* shader_path, const std::string& defines = std::string());
+   [[nodiscard]] static bool isProgramCacheUsable();
+   [[nodiscard]] static uint64_t getSourceHash(const std::vector<StageSource>& stages);
+   [[nodiscard]] static std::string getProgramCachePath(const ProgramRecipe& recipe);
+   [[nodiscard]] static GLuint loadCachedProgram(const std::string& cache_path, uint64_t source_hash);
+   static void saveProgramToCache(const std::string& cache_path, uint64_t source_hash, GLuint program);
+   // Loads the program from the cache, or starts compiling and linking the stages without waiting for them.
+   [[nodiscard]] static PendingProgram submitProgram(const ProgramRecipe& recipe);
+   [[nodiscard]] static bool isProgramComplete(const PendingProgram& pending);
+   // Waits for the program if it is not complete yet, reports the errors and caches the binary.
+   [[nodiscard]] static bool finishProgram(PendingProgram& pending);
+   static void discardProgram(PendingProgram& pending);
+   [[nodiscard]] GLuint& getProgramSlot(ProgramType type, uint32_t key);
+   void installProgram(PendingProgram& pending, bool is_linked);
+   void setProgramRecipes(ProgramType type, std::vector<ProgramRecipe>&& recipes);
 };
\ No newline at end of file
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "_Common.h"
+
+// Polls the files of a directory on its own thread and reports when any of them was added, removed or modified.
+// A change is only reported once the files stayed the same for one more interval, so a file which is still being
+// saved is not compiled half-written.
+class ShaderFileWatcher final
+{
+public:
+   ShaderFileWatcher(const ShaderFileWatcher&) = delete;
+   ShaderFileWatcher(const ShaderFileWatcher&&) = delete;
+   ShaderFileWatcher& operator=(const ShaderFileWatcher&) = delete;
+   ShaderFileWatcher& operator=(const ShaderFileWatcher&&) = delete;
+
+
+   ShaderFileWatcher();
+   ~ShaderFileWatcher();
+
+   void start(const std::string& directory_path, int interval_in_ms = 250);
+   void stop();
+   // Returns true once for every settled change.
+   [[nodiscard]] bool hasChanged() { return IsChanged.exchange( false, std::memory_order_acq_rel ); }
+
+private:
+   using WriteTimes = std::map<std::string, std::filesystem::file_time_type>;
+
+   bool StopWatching;
+   std::atomic<bool> IsChanged;
+   std::mutex StopLock;
+   std::condition_variable Stopped;
+   std::thread Watcher;
+
+   [[nodiscard]] static WriteTimes getWriteTimes(const std::string& directory_path);
+   void watch(const std::string& directory_path, std::chrono::milliseconds interval);
+};
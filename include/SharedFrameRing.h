@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+// Layout of the POSIX shared-memory frame ring which an external producer process writes and SharedMemorySource reads.
+// The producer publishes a slot by storing WriteSequence, and the consumer hands slots back by storing ReadSequence.
+// A slot is only written while (WriteSequence - ReadSequence) < SlotNum, so the consumer can upload a published slot
+// straight from the mapping. This header is shared with the producer, so it does not depend on the renderer.
+namespace SharedFrameRing
+{
+   constexpr uint32_t Magic = 0x52465053u; // "SPFR"
+   constexpr uint32_t Version = 1;
+   constexpr uint32_t SlotNum = 4;
+   constexpr size_t PageSize = 4096;
+
+   // Same values as FrameSource::PixelFormat.
+   enum Format : uint32_t { BGR = 0, I420, NV12 };
+
+   struct SlotHeader
+   {
+      uint64_t Sequence;
+      int64_t PublishedTimeInNs; // std::chrono::steady_clock, which is shared by the processes of one machine
+   };
+
+   struct Header
+   {
+      uint32_t Magic;
+      uint32_t Version;
+      uint32_t Width;
+      uint32_t Height;
+      uint32_t Format;
+      uint32_t SlotNum;
+      uint64_t SlotSize; // bytes of one slot including its padding
+      uint64_t DataOffset; // bytes from the beginning of the mapping to the first slot
+      double FPS;
+      std::atomic<uint32_t> IsProducing;
+      std::atomic<uint64_t> DroppedFrameNum; // frames the producer skipped because the consumer held every slot
+      alignas(64) std::atomic<uint64_t> WriteSequence; // only written by the producer
+      alignas(64) std::atomic<uint64_t> ReadSequence; // only written by the consumer
+      alignas(64) SlotHeader Slots[SharedFrameRing::SlotNum];
+   };
+
+   static_assert( std::atomic<uint64_t>::is_always_lock_free, "the ring needs address-free atomics" );
+   static_assert( std::atomic<uint32_t>::is_always_lock_free, "the ring needs address-free atomics" );
+
+   inline size_t getFrameSize(uint32_t width, uint32_t height, uint32_t format)
+   {
+      const size_t pixel_num = static_cast<size_t>(width) * height;
+      return format == BGR ? pixel_num * 3 : pixel_num * 3 / 2;
+   }
+
+   inline size_t alignToPage(size_t size) { return (size + PageSize - 1) & ~(PageSize - 1); }
+
+   inline size_t getMappingSize(uint32_t width, uint32_t height, uint32_t format)
+   {
+      return alignToPage( sizeof(Header) ) + alignToPage( getFrameSize( width, height, format ) ) * SlotNum;
+   }
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "FrameSource.h"
+#include "SharedFrameRing.h"
+
+// Presents the frames which an external process publishes into a SharedFrameRing.
+// The ring slots of FrameSource are headers on the shared slots, so a frame is uploaded from the mapping without a copy.
+// Live frames are due as soon as they arrive, and the render thread shows the newest one.
+class SharedMemorySource final : public FrameSource
+{
+public:
+   SharedMemorySource(const SharedMemorySource&) = delete;
+   SharedMemorySource(const SharedMemorySource&&) = delete;
+   SharedMemorySource& operator=(const SharedMemorySource&) = delete;
+   SharedMemorySource& operator=(const SharedMemorySource&&) = delete;
+
+
+   SharedMemorySource();
+   ~SharedMemorySource() override;
+
+   // The name is the one given to shm_open() by the producer, e.g. "/SlideProjector".
+   [[nodiscard]] bool open(const std::string& name, cv::Mat& first_frame, bool use_planar_yuv) override;
+   void close() override;
+   void printStatistics() const override;
+
+private:
+   SharedFrameRing::Header* Ring;
+   size_t MappingSize;
+   std::atomic<uint64_t> LatencySumInNs;
+   std::atomic<int64_t> MaxLatencyInNs;
+   std::atomic<uint64_t> MeasuredFrameNum;
+
+   void decode() override;
+};
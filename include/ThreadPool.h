@@ -0,0 +1,41 @@
+#pragma once
+
+#include "_Common.h"
+
+// Fixed set of worker threads. Jobs are started in submission order, and then run concurrently on the workers.
+class ThreadPool final
+{
+public:
+   ThreadPool(const ThreadPool&) = delete;
+   ThreadPool(const ThreadPool&&) = delete;
+   ThreadPool& operator=(const ThreadPool&) = delete;
+   ThreadPool& operator=(const ThreadPool&&) = delete;
+
+
+   explicit ThreadPool(int thread_num);
+   ~ThreadPool();
+
+   template<typename T>
+   [[nodiscard]] std::future<std::invoke_result_t<T>> submit(T&& job)
+   {
+      using R = std::invoke_result_t<T>;
+      auto task = std::make_shared<std::packaged_task<R()>>( std::forward<T>( job ) );
+      std::future<R> result = task->get_future();
+      {
+         std::lock_guard<std::mutex> lock(JobLock);
+         Jobs.emplace( [task]() { (*task)(); } );
+      }
+      JobAdded.notify_one();
+      return result;
+   }
+   [[nodiscard]] int getThreadNum() const { return static_cast<int>(Workers.size()); }
+
+private:
+   bool IsStopped;
+   std::mutex JobLock;
+   std::condition_variable JobAdded;
+   std::queue<std::function<void()>> Jobs;
+   std::vector<std::thread> Workers;
+
+   void work();
+};
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// Reorders triangle lists for the post-transform vertex cache of the GPU. It only works on indices,
+// so it does not depend on the renderer and the vertex cache check links it alone.
+namespace VertexCache
+{
+   // Tom Forsyth's linear-speed vertex cache optimization, which greedily emits the triangle whose vertices
+   // score best for a simulated LRU cache.
+   [[nodiscard]] std::vector<uint32_t> optimize(const std::vector<uint32_t>& indices, size_t vertex_num);
+   // Average cache miss ratio: vertices transformed per triangle with a FIFO post-transform cache of the given size.
+   [[nodiscard]] float getAverageCacheMissRatio(const std::vector<uint32_t>& indices, size_t cache_size);
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include "_Common.h"
+#include <gtc/packing.hpp>
+
+// Encodings of one vertex attribute: the type it is given in, how it is stored in the vertex buffer,
+// and how OpenGL reads it back.
+struct Float3Encoding
+{
+   using SourceType = glm::vec3;
+   static constexpr GLint ComponentNum = 3;
+   static constexpr GLenum ComponentType = GL_FLOAT;
+   static constexpr GLboolean IsNormalized = GL_FALSE;
+   static constexpr size_t Size = 3 * sizeof( GLfloat );
+
+   static void encode(const SourceType& value, uint8_t* destination) { std::memcpy( destination, &value[0], Size ); }
+};
+
+struct Float2Encoding
+{
+   using SourceType = glm::vec2;
+   static constexpr GLint ComponentNum = 2;
+   static constexpr GLenum ComponentType = GL_FLOAT;
+   static constexpr GLboolean IsNormalized = GL_FALSE;
+   static constexpr size_t Size = 2 * sizeof( GLfloat );
+
+   static void encode(const SourceType& value, uint8_t* destination) { std::memcpy( destination, &value[0], Size ); }
+};
+
+// A unit vector in 4 bytes instead of 12, with 10 signed bits per component. The fourth component is unused.
+struct PackedNormalEncoding
+{
+   using SourceType = glm::vec3;
+   static constexpr GLint ComponentNum = 4;
+   static constexpr GLenum ComponentType = GL_INT_2_10_10_10_REV;
+   static constexpr GLboolean IsNormalized = GL_TRUE;
+   static constexpr size_t Size = sizeof( uint32_t );
+
+   static void encode(const SourceType& value, uint8_t* destination)
+   {
+      const uint32_t packed = glm::packSnorm3x10_1x2( glm::vec4(value, 0.0f) );
+      std::memcpy( destination, &packed, Size );
+   }
+};
+
+// Texture coordinates in 4 bytes instead of 8, which keeps about 11 bits of precision in [0, 1].
+struct Half2Encoding
+{
+   using SourceType = glm::vec2;
+   static constexpr GLint ComponentNum = 2;
+   static constexpr GLenum ComponentType = GL_HALF_FLOAT;
+   static constexpr GLboolean IsNormalized = GL_FALSE;
+   static constexpr size_t Size = sizeof( uint32_t );
+
+   static void encode(const SourceType& value, uint8_t* destination)
+   {
+      const uint32_t packed = glm::packHalf2x16( value );
+      std::memcpy( destination, &packed, Size );
+   }
+};
+
+template<GLuint Location, typename Encoding>
+struct VertexAttribute : Encoding
+{
+   static constexpr GLuint AttributeLocation = Location;
+};
+
+// Interleaved vertex layout of the attributes in the given order. The stride and the offsets are computed
+// at compile time, and a vertex is written attribute by attribute straight into its place in the buffer.
+template<typename... Attributes>
+struct VertexFormat
+{
+   static constexpr size_t AttributeNum = sizeof...(Attributes);
+   static constexpr size_t Stride = (Attributes::Size + ...);
+   static constexpr std::array<size_t, AttributeNum> Offsets = []()
+   {
+      constexpr std::array<size_t, AttributeNum> sizes{ Attributes::Size... };
+      std::array<size_t, AttributeNum> offsets{};
+      for (size_t i = 1; i < AttributeNum; ++i) offsets[i] = offsets[i - 1] + sizes[i - 1];
+      return offsets;
+   }();
+   static_assert( Stride % 4 == 0, "Vertex attributes should stay 4-byte aligned." );
+
+   static void setAttributes(GLuint vao, GLuint binding_index)
+   {
+      setAttributes( vao, binding_index, std::index_sequence_for<Attributes...>() );
+   }
+
+   // Every source holds one value per vertex for the attribute at the same position.
+   static void interleave(uint8_t* destination, size_t vertex_num, const typename Attributes::SourceType*... sources)
+   {
+      for (size_t i = 0; i < vertex_num; ++i, destination += Stride) {
+         encodeVertex( destination, i, std::index_sequence_for<Attributes...>(), sources... );
+      }
+   }
+
+private:
+   template<size_t... I>
+   static void setAttributes(GLuint vao, GLuint binding_index, std::index_sequence<I...>)
+   {
+      (
+         (
+            glVertexArrayAttribFormat(
+               vao, Attributes::AttributeLocation, Attributes::ComponentNum, Attributes::ComponentType,
+               Attributes::IsNormalized, static_cast<GLuint>(Offsets[I])
+            ),
+            glEnableVertexArrayAttrib( vao, Attributes::AttributeLocation ),
+            glVertexArrayAttribBinding( vao, Attributes::AttributeLocation, binding_index )
+         ), ...
+      );
+   }
+
+   template<size_t... I>
+   static void encodeVertex(
+      uint8_t* vertex,
+      size_t index,
+      std::index_sequence<I...>,
+      const typename Attributes::SourceType*... sources
+   )
+   {
+      (Attributes::encode( sources[index], vertex + Offsets[I] ), ...);
+   }
+};
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "FrameSource.h"
+#include "FrameCache.h"
+#include "KeyFrameIndex.h"
+
+// Decodes a video into the frame ring of FrameSource.
+// Clips of a playlist are played back to back on one timeline; the next clip is pre-rolled by a second
+// decoder before the current one ends, so the switch happens on the frame boundary.
+// Decoded frames are optionally kept in a FrameCache, so replaying a short loop or scrubbing backward does not decode again.
+// A seek starts decoding at the preceding key frame of the KeyFrameIndex of the clip, or continues from the current
+// position if no key frame lies in between.
+class VideoDecoder final : public FrameSource
+{
+public:
+   VideoDecoder(const VideoDecoder&) = delete;
+   VideoDecoder(const VideoDecoder&&) = delete;
+   VideoDecoder& operator=(const VideoDecoder&) = delete;
+   VideoDecoder& operator=(const VideoDecoder&&) = delete;
+
+
+   explicit VideoDecoder(int queue_size = 4);
+   ~VideoDecoder() override;
+
+   [[nodiscard]] bool open(const std::string& video_path, cv::Mat& first_frame, bool use_planar_yuv) override;
+   [[nodiscard]] bool open(
+      const std::vector<std::string>& playlist,
+      cv::Mat& first_frame,
+      bool use_planar_yuv = false
+   );
+   void close() override;
+   void setFrameCacheBudget(size_t budget_in_bytes) { CacheBudget = budget_in_bytes; } // applied on the next open()
+   void printStatistics() const override;
+   [[nodiscard]] uint64_t getSwitchedClipNum() const { return SwitchedClipNum.load( std::memory_order_relaxed ); }
+   [[nodiscard]] uint64_t getCachedFrameNum() const { return CachedFrameNum.load( std::memory_order_relaxed ); }
+   [[nodiscard]] uint64_t getCacheHitNum() const { return CacheHitNum.load( std::memory_order_relaxed ); }
+   [[nodiscard]] size_t getFrameCacheBudget() const { return CacheBudget; }
+
+private:
+   // The next clip is opened and its first frame decoded in the background.
+   struct Preroll
+   {
+      std::unique_ptr<cv::VideoCapture> Video;
+      cv::Mat FirstFrame;
+      ClipInfo Clip;
+   };
+
+   bool UsePlanarYUV;
+   std::vector<std::string> Playlist;
+   std::vector<std::unique_ptr<KeyFrameIndex>> KeyFrames; // one per clip of the playlist, built on open()
+   std::atomic<uint64_t> SwitchedClipNum;
+   std::atomic<uint64_t> CachedFrameNum;
+   std::atomic<uint64_t> CacheHitNum; // frames which were served from the cache instead of the decoder
+   size_t CacheBudget;
+   FrameCache Cache;
+   std::unique_ptr<cv::VideoCapture> Video;
+
+   [[nodiscard]] static bool openClip(
+      cv::VideoCapture& video,
+      const std::string& video_path,
+      cv::Mat& first_frame,
+      ClipInfo& clip,
+      bool use_planar_yuv
+   );
+   [[nodiscard]] bool hasNextClip(size_t clip_index) const;
+   // Moves the capture from the frame it decodes next to the given frame, and returns false if it cannot get there.
+   [[nodiscard]] bool seekCapture(size_t clip_index, int& video_frame_index, int frame_index);
+   void decode() override;
+};
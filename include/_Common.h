@@ -16,12 +16,24 @@
 #include <iostream>
 #include <iomanip>
 #include <vector>
+#include <array>
 #include <string>
 #include <map>
+#include <list>
 #include <unordered_map>
 #include <sstream>
 #include <fstream>
 #include <chrono>
+#include <thread>
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <queue>
+#include <deque>
+#include <filesystem>
+#include <random>
 
 #include "ProjectPath.h"
 
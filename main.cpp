@@ -1,8 +1,11 @@
 #include "Renderer.h"
 
-int main()
+int main(int argc, char** argv)
 {
-   RendererGL renderer;
+   RendererGL::Options options;
+   if (!RendererGL::parseArguments( argc, argv, options )) return 1;
+
+   RendererGL renderer( options );
    renderer.play();
    return 0;
-}
\ No newline at end of file
+}
@@ -1,10 +1,14 @@
-#version 460
+#version 450
 
-#define MAX_LIGHTS 32
+// ShaderGL injects the features of a permutation after the version line:
+//  - PROJECT_SLIDE: the slide is projected onto the surface from the projector
+//  - USE_LIGHTING: the surface is lit by the lights, which are culled per cluster
+//  - SAMPLE_SLIDE: the slide is sampled with the texture coordinates of the screen
+// Without any of them, the surface is drawn in its diffuse color.
 
+#ifdef USE_LIGHTING
 struct LightInfo
 {
-   int LightSwitch;
    vec4 Position;
    vec4 AmbientColor;
    vec4 DiffuseColor;
@@ -13,8 +17,42 @@ struct LightInfo
    float SpotlightCutoffAngle;
    float SpotlightFeather;
    float FallOffRadius;
+   int LightSwitch;
+};
+
+struct ViewLightInfo
+{
+   vec4 Position; // w is 0 for a directional light
+   vec4 SpotlightDirection; // w is the influence radius
+};
+
+// Mirrored by LightGL, which only uploads the lights that changed.
+layout (std430, binding = 0) readonly buffer LightBlock
+{
+   vec4 GlobalAmbient;
+   int UseLight;
+   int LightNum;
+   LightInfo Lights[];
+};
+
+// Written by LightTransform.comp, LightCulling.comp and LightListOffsets.comp before the objects are drawn.
+layout (std430, binding = 1) readonly buffer ViewLightBlock
+{
+   ViewLightInfo ViewLights[];
 };
-uniform LightInfo Lights[MAX_LIGHTS];
+
+layout (std430, binding = 2) readonly buffer LightGridBlock
+{
+   uint LightIndexNum; // the indices which all clusters need
+   uint LightIndexCapacity; // the indices which LightIndexBlock holds
+   uvec2 ClusterLights[]; // x: the offset in ClusterLightIndices, y: the number of lights
+};
+
+layout (std430, binding = 3) readonly buffer LightIndexBlock
+{
+   uint ClusterLightIndices[];
+};
+#endif
 
 struct MateralInfo {
    vec4 EmissionColor;
@@ -23,18 +61,31 @@ struct MateralInfo {
    vec4 SpecularColor;
    float SpecularExponent;
 };
-uniform MateralInfo Material;
 
-layout (binding = 0) uniform sampler2D BaseTexture;
-
-uniform int UseLight;
-uniform int LightNum;
-uniform vec4 GlobalAmbient;
+layout (std140, binding = 0) uniform FrameBlock
+{
+   mat4 ViewMatrix;
+   mat4 ProjectionMatrix;
+   int SlideFormat; // 0: BGR, 1: I420, 2: NV12
+   mat4 InverseProjectionMatrix;
+   ivec4 LightCluster; // xyz: cluster counts, w: 1 if the lights are culled per cluster
+   vec4 ClusterDepth; // near, far, slice scale and slice bias of log(-z)
+   vec4 Viewport; // width, height, tile width and tile height in pixels
+};
 
-uniform mat4 ViewMatrix;
-uniform mat4 ProjectionMatrix;
+layout (std140, binding = 1) uniform ObjectBlock
+{
+   mat4 ModelViewMatrix;
+   mat4 ModelViewProjectionMatrix;
+   mat4 NormalMatrix;
+   mat4 ProjectorTextureMatrix; // from the object to the homogeneous slide coordinates, top row first
+   MateralInfo Material;
+   int UseTexture;
+};
 
-uniform int WhichObject; // 0: Wall, 1: Screen, 2: Projector
+layout (binding = 0) uniform sampler2D BaseTexture; // the luma plane if the slide is planar YUV
+layout (binding = 1) uniform sampler2D ChromaUTexture; // U for I420, interleaved UV for NV12
+layout (binding = 2) uniform sampler2D ChromaVTexture;
 
 in vec3 position_in_ec;
 in vec3 normal_in_ec;
@@ -48,6 +99,7 @@ const float zero = 0.0f;
 const float one = 1.0f;
 const float half_pi = 1.57079632679489661923132169163975144f;
 
+#ifdef USE_LIGHTING
 bool IsPointLight(in vec4 light_position)
 {
    return light_position.w != zero;
@@ -59,6 +111,8 @@ float getAttenuation(in vec3 light_vector, in int light_index)
    float distance = sqrt( squared_distance );
    float radius = Lights[light_index].FallOffRadius;
    if (distance <= radius) return one;
+   // Beyond the influence radius the light is culled, so it has to contribute nothing here either.
+   if (distance > ViewLights[light_index].SpotlightDirection.w) return zero;
 
    return clamp( radius * radius / squared_distance, zero, one );
 }
@@ -67,8 +121,7 @@ float getSpotlightFactor(in vec3 normalized_light_vector, in int light_index)
 {
    if (Lights[light_index].SpotlightCutoffAngle >= 180.0f) return one;
 
-   vec4 direction_in_ec = transpose( inverse( ViewMatrix ) ) * vec4(Lights[light_index].SpotlightDirection, zero);
-   vec3 normalized_direction = normalize( direction_in_ec.xyz );
+   vec3 normalized_direction = ViewLights[light_index].SpotlightDirection.xyz;
    float factor = dot( -normalized_light_vector, normalized_direction );
    float cutoff_angle = radians( clamp( Lights[light_index].SpotlightCutoffAngle, zero, 90.0f ) );
    if (factor >= cos( cutoff_angle )) {
@@ -80,63 +133,104 @@ float getSpotlightFactor(in vec3 normalized_light_vector, in int light_index)
    return zero;
 }
 
-vec4 calculateLightingEquation()
+vec4 getLightColor(in int light_index)
 {
-   vec4 color = Material.EmissionColor + GlobalAmbient * Material.AmbientColor;
+   vec4 light_position_in_ec = ViewLights[light_index].Position;
 
-   for (int i = 0; i < LightNum; ++i) {
-      if (Lights[i].LightSwitch == 0) continue;
-      
-      vec4 light_position_in_ec = ViewMatrix * Lights[i].Position;
-      
-      float final_effect_factor = one;
-      vec3 light_vector = light_position_in_ec.xyz - position_in_ec;
-      if (IsPointLight( light_position_in_ec )) {
-         float attenuation = getAttenuation( light_vector, i );
-
-         light_vector = normalize( light_vector );
-         float spotlight_factor = getSpotlightFactor( light_vector, i );
-         final_effect_factor = attenuation * spotlight_factor;
-      }
-      else light_vector = normalize( light_position_in_ec.xyz );
-   
-      if (final_effect_factor <= zero) continue;
+   float final_effect_factor = one;
+   vec3 light_vector = light_position_in_ec.xyz - position_in_ec;
+   if (IsPointLight( light_position_in_ec )) {
+      float attenuation = getAttenuation( light_vector, light_index );
+
+      light_vector = normalize( light_vector );
+      float spotlight_factor = getSpotlightFactor( light_vector, light_index );
+      final_effect_factor = attenuation * spotlight_factor;
+   }
+   else light_vector = normalize( light_position_in_ec.xyz );
+
+   if (final_effect_factor <= zero) return vec4(zero);
 
-      vec4 local_color = Lights[i].AmbientColor * Material.AmbientColor;
+   vec4 local_color = Lights[light_index].AmbientColor * Material.AmbientColor;
 
-      float diffuse_intensity = max( dot( normal_in_ec, light_vector ), zero );
-      local_color += diffuse_intensity * Lights[i].DiffuseColor * Material.DiffuseColor;
+   float diffuse_intensity = max( dot( normal_in_ec, light_vector ), zero );
+   local_color += diffuse_intensity * Lights[light_index].DiffuseColor * Material.DiffuseColor;
+
+   vec3 halfway_vector = normalize( light_vector - normalize( position_in_ec ) );
+   float specular_intensity = max( dot( normal_in_ec, halfway_vector ), zero );
+   local_color += 
+      pow( specular_intensity, Material.SpecularExponent ) * 
+      Lights[light_index].SpecularColor * Material.SpecularColor;
+
+   return local_color * final_effect_factor;
+}
+
+uint getClusterIndex()
+{
+   uvec3 cluster;
+   cluster.xy = uvec2(gl_FragCoord.xy / Viewport.zw);
+   cluster.z = uint(max( log( -position_in_ec.z ) * ClusterDepth.z + ClusterDepth.w, zero ));
+   cluster = min( cluster, uvec3(LightCluster.xyz) - 1u );
+   return cluster.x + uint(LightCluster.x) * (cluster.y + uint(LightCluster.y) * cluster.z);
+}
 
-      vec3 halfway_vector = normalize( light_vector - normalize( position_in_ec ) );
-      float specular_intensity = max( dot( normal_in_ec, halfway_vector ), zero );
-      local_color += 
-         pow( specular_intensity, Material.SpecularExponent ) * 
-         Lights[i].SpecularColor * Material.SpecularColor;
+vec4 calculateLightingEquation()
+{
+   vec4 color = Material.EmissionColor + GlobalAmbient * Material.AmbientColor;
 
-      color += local_color * final_effect_factor;
+   // Only the lights binned into the cluster of this fragment can reach it. Until the index list has grown to
+   // what the clusters need, the clusters which do not fit into it shade every light.
+   uvec2 light_list = LightCluster.w != 0 ? ClusterLights[getClusterIndex()] : uvec2(0u);
+   if (LightCluster.w != 0 && light_list.x + light_list.y <= LightIndexCapacity) {
+      for (uint i = 0; i < light_list.y; ++i) color += getLightColor( int(ClusterLightIndices[light_list.x + i]) );
+   }
+   else {
+      for (int i = 0; i < LightNum; ++i) {
+         if (Lights[i].LightSwitch != 0) color += getLightColor( i );
+      }
    }
    return color;
 }
+#endif
+
+vec4 getSlideColor(in vec2 slide_coord)
+{
+   if (SlideFormat == 0) return texture( BaseTexture, slide_coord );
+
+   // BT.601 limited range to RGB
+   float luma = 1.164383f * (texture( BaseTexture, slide_coord ).r - 0.062745f);
+   vec2 chroma = SlideFormat == 1 ?
+      vec2(texture( ChromaUTexture, slide_coord ).r, texture( ChromaVTexture, slide_coord ).r) :
+      texture( ChromaUTexture, slide_coord ).rg;
+   chroma -= 0.5f;
+   vec3 rgb = vec3(
+      luma + 1.596027f * chroma.y,
+      luma - 0.391762f * chroma.x - 0.812968f * chroma.y,
+      luma + 2.017232f * chroma.x
+   );
+   return vec4(clamp( rgb, zero, one ), one);
+}
 
 vec4 getProjectorColor()
 {
    if (zero <= projector_tex_coord.x && projector_tex_coord.x <= projector_tex_coord.z &&
        zero <= projector_tex_coord.y && projector_tex_coord.y <= projector_tex_coord.z &&
        zero < projector_tex_coord.z) {
-      return texture2DProj( BaseTexture, projector_tex_coord );
+      return getSlideColor( projector_tex_coord.xy / projector_tex_coord.z );
    }
    return Material.DiffuseColor;
 }
 
 void main()
 {
-   if (WhichObject == 0) {
-      vec4 projector_color = getProjectorColor();
-      if (UseLight != 0) {
-         final_color = mix( projector_color, calculateLightingEquation(), 0.7f );
-      }
-      else final_color = Material.DiffuseColor;
-   }
-   else if (WhichObject == 1) final_color = texture( BaseTexture, tex_coord );
-   else final_color = Material.DiffuseColor;
+   vec4 color = Material.DiffuseColor;
+#ifdef SAMPLE_SLIDE
+   color = getSlideColor( tex_coord );
+#endif
+#ifdef PROJECT_SLIDE
+   color = getProjectorColor();
+#endif
+#ifdef USE_LIGHTING
+   color = mix( color, calculateLightingEquation(), 0.7f );
+#endif
+   final_color = color;
 }
\ No newline at end of file
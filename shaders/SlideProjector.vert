@@ -1,12 +1,37 @@
-#version 460
-
-uniform mat4 WorldMatrix;
-uniform mat4 ViewMatrix;
-uniform mat4 ProjectionMatrix;
-uniform mat4 ModelViewProjectionMatrix;
-
-uniform mat4 ProjectorViewMatrix;
-uniform mat4 ProjectorProjectionMatrix;
+#version 450
+
+struct MateralInfo {
+   vec4 EmissionColor;
+   vec4 AmbientColor;
+   vec4 DiffuseColor;
+   vec4 SpecularColor;
+   float SpecularExponent;
+};
+
+// The features of a permutation are injected after the version line as in SlideProjector.frag.
+// The outputs which a permutation does not need are left unwritten.
+
+// The blocks are declared the same in every stage and mirrored by ShaderGL::FrameUniformBlock and ObjectUniformBlock.
+layout (std140, binding = 0) uniform FrameBlock
+{
+   mat4 ViewMatrix;
+   mat4 ProjectionMatrix;
+   int SlideFormat; // 0: BGR, 1: I420, 2: NV12
+   mat4 InverseProjectionMatrix;
+   ivec4 LightCluster; // xyz: cluster counts, w: 1 if the lights are culled per cluster
+   vec4 ClusterDepth; // near, far, slice scale and slice bias of log(-z)
+   vec4 Viewport; // width, height, tile width and tile height in pixels
+};
+
+layout (std140, binding = 1) uniform ObjectBlock
+{
+   mat4 ModelViewMatrix;
+   mat4 ModelViewProjectionMatrix;
+   mat4 NormalMatrix;
+   mat4 ProjectorTextureMatrix; // from the object to the homogeneous slide coordinates, top row first
+   MateralInfo Material;
+   int UseTexture;
+};
 
 layout (location = 0) in vec3 v_position;
 layout (location = 1) in vec3 v_normal;
@@ -20,17 +45,18 @@ out vec3 projector_tex_coord;
 
 void main()
 {   
-   vec4 e_position = ViewMatrix * WorldMatrix * vec4(v_position, 1.0f);
-   vec4 e_normal = transpose( inverse( ViewMatrix * WorldMatrix ) ) * vec4(v_normal, 1.0f);
-   position_in_ec = e_position.xyz;
-   normal_in_ec = normalize( e_normal.xyz );
+#ifdef USE_LIGHTING
+   position_in_ec = vec3(ModelViewMatrix * vec4(v_position, 1.0f));
+   normal_in_ec = normalize( mat3(NormalMatrix) * v_normal );
+#endif
 
+#ifdef SAMPLE_SLIDE
    tex_coord = v_tex_coord;    
+#endif
 
-   vec4 projector_point_in_cc = ProjectorProjectionMatrix * ProjectorViewMatrix * WorldMatrix * vec4(v_position, 1.0f);
-   projector_tex_coord.x = 0.5f * projector_point_in_cc.x + 0.5f * projector_point_in_cc.w;
-   projector_tex_coord.y = 0.5f * projector_point_in_cc.y + 0.5f * projector_point_in_cc.w;
-   projector_tex_coord.z = projector_point_in_cc.w;
+#ifdef PROJECT_SLIDE
+   projector_tex_coord = vec3(ProjectorTextureMatrix * vec4(v_position, 1.0f));
+#endif
 
    gl_Position = ModelViewProjectionMatrix * vec4(v_position, 1.0f);
 }
\ No newline at end of file
@@ -0,0 +1,167 @@
+#include "BoundingVolumeHierarchy.h"
+
+#include <numeric>
+
+void BoundingVolumeHierarchy::build(const std::vector<glm::vec3>& vertices, std::vector<uint32_t>& indices)
+{
+   Nodes.clear();
+   const auto triangle_num = static_cast<uint32_t>(indices.size() / 3);
+   if (triangle_num == 0) return;
+
+   std::vector<glm::vec3> centroids(triangle_num), mins(triangle_num), maxes(triangle_num);
+   for (uint32_t t = 0; t < triangle_num; ++t) {
+      const glm::vec3& a = vertices[indices[t * 3]];
+      const glm::vec3& b = vertices[indices[t * 3 + 1]];
+      const glm::vec3& c = vertices[indices[t * 3 + 2]];
+      mins[t] = glm::min( a, glm::min( b, c ) );
+      maxes[t] = glm::max( a, glm::max( b, c ) );
+      centroids[t] = (a + b + c) / 3.0f;
+   }
+
+   std::vector<uint32_t> triangles(triangle_num);
+   std::iota( triangles.begin(), triangles.end(), 0 );
+   buildNode( triangles, 0, triangle_num, centroids, mins, maxes );
+
+   std::vector<uint32_t> reordered(triangle_num * 3);
+   for (uint32_t i = 0; i < triangle_num; ++i) {
+      std::copy_n( indices.begin() + triangles[i] * 3, 3, reordered.begin() + i * 3 );
+   }
+   indices.swap( reordered );
+}
+
+uint32_t BoundingVolumeHierarchy::buildNode(
+   std::vector<uint32_t>& triangles,
+   uint32_t begin,
+   uint32_t end,
+   const std::vector<glm::vec3>& centroids,
+   const std::vector<glm::vec3>& mins,
+   const std::vector<glm::vec3>& maxes
+)
+{
+   const auto node_index = static_cast<uint32_t>(Nodes.size());
+   Node node{};
+   node.Min = glm::vec3(std::numeric_limits<float>::max());
+   node.Max = glm::vec3(std::numeric_limits<float>::lowest());
+   glm::vec3 centroid_min = node.Min;
+   glm::vec3 centroid_max = node.Max;
+   for (uint32_t i = begin; i < end; ++i) {
+      const uint32_t t = triangles[i];
+      node.Min = glm::min( node.Min, mins[t] );
+      node.Max = glm::max( node.Max, maxes[t] );
+      centroid_min = glm::min( centroid_min, centroids[t] );
+      centroid_max = glm::max( centroid_max, centroids[t] );
+   }
+   node.FirstIndex = begin * 3;
+   node.IndexNum = (end - begin) * 3;
+   Nodes.emplace_back( node );
+
+   const glm::vec3 extent = centroid_max - centroid_min;
+   int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : extent.y >= extent.z ? 1 : 2;
+   if (end - begin <= MaxChunkTriangleNum || extent[axis] <= 0.0f) {
+      std::sort( triangles.begin() + begin, triangles.begin() + end );
+      return node_index;
+   }
+
+   const uint32_t middle = begin + (end - begin) / 2;
+   std::nth_element(
+      triangles.begin() + begin, triangles.begin() + middle, triangles.begin() + end,
+      [&centroids, axis](uint32_t a, uint32_t b) { return centroids[a][axis] < centroids[b][axis]; }
+   );
+   buildNode( triangles, begin, middle, centroids, mins, maxes );
+   const uint32_t second_child = buildNode( triangles, middle, end, centroids, mins, maxes );
+   Nodes[node_index].SecondChild = second_child;
+   return node_index;
+}
+
+void BoundingVolumeHierarchy::getFrustumPlanes(const glm::mat4& view_projection, std::array<glm::vec4, 6>& planes)
+{
+   // A point is inside if -w <= x, y, z <= w in the clip space, and each inequality is a plane of the rows.
+   const glm::mat4 rows = glm::transpose( view_projection );
+   planes[0] = rows[3] + rows[0];
+   planes[1] = rows[3] - rows[0];
+   planes[2] = rows[3] + rows[1];
+   planes[3] = rows[3] - rows[1];
+   planes[4] = rows[3] + rows[2];
+   planes[5] = rows[3] - rows[2];
+}
+
+BoundingVolumeHierarchy::Containment BoundingVolumeHierarchy::classify(
+   const Node& node,
+   const glm::vec4* planes,
+   int plane_num
+)
+{
+   Containment containment = INSIDE;
+   for (int i = 0; i < plane_num; ++i) {
+      const glm::vec3 normal(planes[i]);
+      // The corners of the box which are the farthest along and against the plane normal.
+      const glm::vec3 farthest = glm::mix( node.Min, node.Max, glm::greaterThanEqual( normal, glm::vec3(0.0f) ) );
+      const glm::vec3 nearest = glm::mix( node.Max, node.Min, glm::greaterThanEqual( normal, glm::vec3(0.0f) ) );
+      if (glm::dot( normal, farthest ) + planes[i].w < 0.0f) return OUTSIDE;
+      if (glm::dot( normal, nearest ) + planes[i].w < 0.0f) containment = INTERSECTING;
+   }
+   return containment;
+}
+
+void BoundingVolumeHierarchy::appendChunk(std::vector<Chunk>& chunks, const Node& node)
+{
+   if (!chunks.empty() && chunks.back().FirstIndex + chunks.back().IndexNum == node.FirstIndex) {
+      chunks.back().IndexNum += node.IndexNum;
+   }
+   else chunks.push_back( { node.FirstIndex, node.IndexNum } );
+}
+
+void BoundingVolumeHierarchy::cull(
+   const glm::mat4& camera_view_projection,
+   const glm::mat4& projector_view_projection,
+   std::vector<Chunk>& projected_chunks,
+   std::vector<Chunk>& unprojected_chunks
+) const
+{
+   projected_chunks.clear();
+   unprojected_chunks.clear();
+   if (Nodes.empty()) return;
+
+   std::array<glm::vec4, 6> camera_planes{}, projector_planes{};
+   getFrustumPlanes( camera_view_projection, camera_planes );
+   getFrustumPlanes( projector_view_projection, projector_planes );
+   cullNode(
+      0, INTERSECTING, INTERSECTING, camera_planes, projector_planes, projected_chunks, unprojected_chunks
+   );
+}
+
+void BoundingVolumeHierarchy::cullNode(
+   uint32_t node_index,
+   Containment camera_containment,
+   Containment projector_containment,
+   const std::array<glm::vec4, 6>& camera_planes,
+   const std::array<glm::vec4, 6>& projector_planes,
+   std::vector<Chunk>& projected_chunks,
+   std::vector<Chunk>& unprojected_chunks
+) const
+{
+   // Only a containment which is not decided yet is tested, as the children of a contained node are contained too.
+   const Node& node = Nodes[node_index];
+   if (camera_containment == INTERSECTING) {
+      camera_containment = classify( node, camera_planes.data(), 6 );
+      if (camera_containment == OUTSIDE) return;
+   }
+   // The slide is projected without the near and far planes of the projector, so only its side planes cull.
+   if (projector_containment == INTERSECTING) {
+      projector_containment = classify( node, projector_planes.data(), 4 );
+   }
+
+   const bool is_decided = camera_containment == INSIDE && projector_containment != INTERSECTING;
+   if (is_decided || node.SecondChild == 0) {
+      appendChunk( projector_containment == OUTSIDE ? unprojected_chunks : projected_chunks, node );
+      return;
+   }
+   cullNode(
+      node_index + 1, camera_containment, projector_containment,
+      camera_planes, projector_planes, projected_chunks, unprojected_chunks
+   );
+   cullNode(
+      node.SecondChild, camera_containment, projector_containment,
+      camera_planes, projector_planes, projected_chunks, unprojected_chunks
+   );
+}
@@ -20,13 +20,55 @@ CameraGL::CameraGL(
    IsMoving( false ), Width( 0 ), Height( 0 ), FOV( fov ), InitFOV( fov ), NearPlane( near_plane ), FarPlane( far_plane ),
    AspectRatio( 0.0f ), ZoomSensitivity( 1.0f ), MoveSensitivity( 0.05f ), RotationSensitivity( 0.005f ),  
    InitCamPos( cam_position ), InitRefPos( view_reference_position ), InitUpVec( view_up_vector ), CamPos( cam_position ),
-   ViewMatrix( lookAt( InitCamPos, InitRefPos, InitUpVec ) ), ProjectionMatrix(glm::mat4(1.0f) )
+   ViewMatrix( lookAt( InitCamPos, InitRefPos, InitUpVec ) ), ProjectionMatrix(glm::mat4(1.0f) ), Revision( 0 ),
+   DirtyMatrices( INVERSE_VIEW | INVERSE_PROJECTION | VIEW_PROJECTION ), InverseViewMatrix( 1.0f ),
+   InverseProjectionMatrix( 1.0f ), ViewProjectionMatrix( 1.0f )
 {
 }
 
+void CameraGL::setViewChanged()
+{
+   DirtyMatrices |= INVERSE_VIEW | VIEW_PROJECTION;
+   Revision++;
+}
+
+void CameraGL::setProjectionChanged()
+{
+   DirtyMatrices |= INVERSE_PROJECTION | VIEW_PROJECTION;
+   Revision++;
+}
+
+const glm::mat4& CameraGL::getInverseViewMatrix() const
+{
+   if (DirtyMatrices & INVERSE_VIEW) {
+      InverseViewMatrix = inverse( ViewMatrix );
+      DirtyMatrices &= ~INVERSE_VIEW;
+   }
+   return InverseViewMatrix;
+}
+
+const glm::mat4& CameraGL::getInverseProjectionMatrix() const
+{
+   if (DirtyMatrices & INVERSE_PROJECTION) {
+      InverseProjectionMatrix = inverse( ProjectionMatrix );
+      DirtyMatrices &= ~INVERSE_PROJECTION;
+   }
+   return InverseProjectionMatrix;
+}
+
+const glm::mat4& CameraGL::getViewProjectionMatrix() const
+{
+   if (DirtyMatrices & VIEW_PROJECTION) {
+      ViewProjectionMatrix = ProjectionMatrix * ViewMatrix;
+      DirtyMatrices &= ~VIEW_PROJECTION;
+   }
+   return ViewProjectionMatrix;
+}
+
 void CameraGL::updateCamera()
 {
-   const glm::mat4 inverse_view = inverse( ViewMatrix );
+   setViewChanged();
+   const glm::mat4& inverse_view = getInverseViewMatrix();
    CamPos.x = inverse_view[3][0];
    CamPos.y = inverse_view[3][1];
    CamPos.z = inverse_view[3][2];
@@ -100,6 +142,7 @@ void CameraGL::zoomIn()
    if (FOV > 0.0f) {
       FOV -= ZoomSensitivity;
       ProjectionMatrix = glm::perspective( glm::radians( FOV ), AspectRatio, NearPlane, FarPlane );
+      setProjectionChanged();
    }
 }
 
@@ -108,6 +151,7 @@ void CameraGL::zoomOut()
    if (FOV < 90.0f) {
       FOV += ZoomSensitivity;
       ProjectionMatrix = glm::perspective( glm::radians( FOV ), AspectRatio, NearPlane, FarPlane );
+      setProjectionChanged();
    }
 }
 
@@ -116,6 +160,19 @@ void CameraGL::resetCamera()
    CamPos = InitCamPos; 
    ViewMatrix = lookAt( InitCamPos, InitRefPos, InitUpVec );
    ProjectionMatrix = glm::perspective( glm::radians( InitFOV ), AspectRatio, NearPlane, FarPlane );
+   setViewChanged();
+   setProjectionChanged();
+}
+
+void CameraGL::placeCamera(
+   const glm::vec3& cam_position,
+   const glm::vec3& view_reference_position,
+   const glm::vec3& view_up_vector
+)
+{
+   CamPos = cam_position;
+   ViewMatrix = lookAt( cam_position, view_reference_position, view_up_vector );
+   setViewChanged();
 }
 
 void CameraGL::updateWindowSize(int width, int height)
@@ -124,4 +181,5 @@ void CameraGL::updateWindowSize(int width, int height)
    Height = height;
    AspectRatio = static_cast<float>(width) / static_cast<float>(height);
    ProjectionMatrix = glm::perspective( glm::radians( FOV ), AspectRatio, NearPlane, FarPlane );
+   setProjectionChanged();
 }
\ No newline at end of file
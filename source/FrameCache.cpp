@@ -0,0 +1,68 @@
+#include "FrameCache.h"
+
+FrameCache::FrameCache(size_t budget_in_bytes) : Budget( budget_in_bytes ), UsedBytes( 0 )
+{
+}
+
+void FrameCache::setBudget(size_t budget_in_bytes)
+{
+   Budget = budget_in_bytes;
+   while (UsedBytes > Budget) evictLeastRecentlyUsed();
+}
+
+void FrameCache::clear()
+{
+   RecentlyUsed.clear();
+   Entries.clear();
+   UsedBytes = 0;
+}
+
+bool FrameCache::contains(size_t clip_index, int frame_index) const
+{
+   return Entries.find( getKey( clip_index, frame_index ) ) != Entries.end();
+}
+
+bool FrameCache::find(size_t clip_index, int frame_index, cv::Mat& frame, double& clip_timestamp)
+{
+   const auto it = Entries.find( getKey( clip_index, frame_index ) );
+   if (it == Entries.end()) return false;
+
+   // The destination is a preallocated ring slot of the same layout, so this is a plain copy.
+   it->second.Frame.copyTo( frame );
+   clip_timestamp = it->second.ClipTimestamp;
+   RecentlyUsed.splice( RecentlyUsed.begin(), RecentlyUsed, it->second.Recency );
+   return true;
+}
+
+cv::Mat FrameCache::evictLeastRecentlyUsed()
+{
+   const auto it = Entries.find( RecentlyUsed.back() );
+   cv::Mat frame = it->second.Frame;
+   UsedBytes -= getByteSize( frame );
+   Entries.erase( it );
+   RecentlyUsed.pop_back();
+   return frame;
+}
+
+void FrameCache::insert(size_t clip_index, int frame_index, const cv::Mat& frame, double clip_timestamp)
+{
+   const size_t frame_size = getByteSize( frame );
+   if (frame_size > Budget) return;
+
+   const uint64_t key = getKey( clip_index, frame_index );
+   const auto it = Entries.find( key );
+   if (it != Entries.end()) {
+      it->second.ClipTimestamp = clip_timestamp;
+      RecentlyUsed.splice( RecentlyUsed.begin(), RecentlyUsed, it->second.Recency );
+      return;
+   }
+
+   // An evicted frame of the same layout is reused, so a full cache does not allocate any more.
+   cv::Mat storage;
+   while (UsedBytes + frame_size > Budget) storage = evictLeastRecentlyUsed();
+   frame.copyTo( storage );
+
+   RecentlyUsed.emplace_front( key );
+   Entries.emplace( key, Entry{ storage, clip_timestamp, RecentlyUsed.begin() } );
+   UsedBytes += frame_size;
+}
@@ -0,0 +1,206 @@
+#include "FrameRecorder.h"
+
+FrameRecorder::FrameRecorder(int buffer_num, int queue_size) :
+   BufferNum( std::max( buffer_num, 2 ) ), QueueSize( std::max( queue_size, 1 ) ), Width( 0 ), Height( 0 ),
+   CanDropFrames( false ), IsVideo( false ), StopEncoding( false ), WriteIndex( 0 ), ReadIndex( 0 ),
+   CapturedFrameNum( 0 ), ReadbackStallNum( 0 ), DroppedFrameNum( 0 ), WrittenFrameNum( 0 )
+{
+}
+
+FrameRecorder::~FrameRecorder()
+{
+   stop();
+}
+
+bool FrameRecorder::openOutput(double fps)
+{
+   std::string extension = std::filesystem::path( OutputPath ).extension().string();
+   std::transform( extension.begin(), extension.end(), extension.begin(), ::tolower );
+   IsVideo = extension == ".mp4" || extension == ".avi" || extension == ".mkv" || extension == ".mov";
+   if (IsVideo) {
+      const int fourcc = extension == ".avi" ?
+         cv::VideoWriter::fourcc( 'M', 'J', 'P', 'G' ) : cv::VideoWriter::fourcc( 'm', 'p', '4', 'v' );
+      Video.open( OutputPath, fourcc, fps, cv::Size(Width, Height) );
+      if (!Video.isOpened()) {
+         std::cout << "Cannot Open the Video Writer for " << OutputPath << "...\n";
+         return false;
+      }
+      return true;
+   }
+
+   std::error_code error;
+   std::filesystem::create_directories( OutputPath, error );
+   if (error) {
+      std::cout << "Cannot Create the Output Directory " << OutputPath << "...\n";
+      return false;
+   }
+   return true;
+}
+
+bool FrameRecorder::start(const std::string& output_path, int width, int height, double fps, bool can_drop_frames)
+{
+   stop();
+
+   OutputPath = output_path;
+   Width = width;
+   Height = height;
+   CanDropFrames = can_drop_frames;
+   if (Width <= 0 || Height <= 0 || !openOutput( fps )) return false;
+
+   // BGRA is the layout drivers copy without swizzling; the alpha is dropped on the encoder thread.
+   const auto buffer_size = static_cast<GLsizeiptr>(Width) * Height * 4;
+   PackBuffers.resize( BufferNum );
+   for (auto& pack : PackBuffers) {
+      glCreateBuffers( 1, &pack.Buffer );
+      glNamedBufferStorage( pack.Buffer, buffer_size, nullptr, GL_MAP_READ_BIT );
+      pack.Fence = nullptr;
+   }
+   WriteIndex = 0;
+   ReadIndex = 0;
+   CapturedFrameNum = 0;
+   ReadbackStallNum = 0;
+   DroppedFrameNum = 0;
+   WrittenFrameNum.store( 0, std::memory_order_relaxed );
+   StopEncoding = false;
+   Encoder = std::thread( &FrameRecorder::encode, this );
+   return true;
+}
+
+void FrameRecorder::capture()
+{
+   if (!isRecording()) return;
+
+   // The buffers whose copies are done are handed over first. Only when every buffer is still in flight,
+   // the oldest one is waited for, which means the GPU is more than the whole ring behind.
+   const auto buffer_num = static_cast<uint64_t>(BufferNum);
+   while (ReadIndex < WriteIndex) {
+      const uint64_t read_index = ReadIndex;
+      retireOldestBuffer( false );
+      if (ReadIndex == read_index) break;
+   }
+   if (WriteIndex - ReadIndex >= buffer_num) {
+      ReadbackStallNum++;
+      retireOldestBuffer( true );
+   }
+
+   PackBuffer& pack = PackBuffers[WriteIndex % buffer_num];
+   glBindBuffer( GL_PIXEL_PACK_BUFFER, pack.Buffer );
+   glReadPixels( 0, 0, Width, Height, GL_BGRA, GL_UNSIGNED_BYTE, nullptr );
+   glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+   pack.Fence = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+   WriteIndex++;
+   CapturedFrameNum++;
+}
+
+void FrameRecorder::retireOldestBuffer(bool wait_for_fence)
+{
+   PackBuffer& pack = PackBuffers[ReadIndex % static_cast<uint64_t>(BufferNum)];
+   GLenum status = glClientWaitSync( pack.Fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0 );
+   while (wait_for_fence && status == GL_TIMEOUT_EXPIRED) {
+      status = glClientWaitSync( pack.Fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000 );
+   }
+   if (status == GL_TIMEOUT_EXPIRED) return;
+
+   glDeleteSync( pack.Fence );
+   pack.Fence = nullptr;
+   ReadIndex++;
+   if (status == GL_WAIT_FAILED) {
+      DroppedFrameNum++;
+      return;
+   }
+
+   cv::Mat frame;
+   {
+      std::unique_lock<std::mutex> lock(QueueLock);
+      if (static_cast<int>(EncodingFrames.size()) >= QueueSize) {
+         if (CanDropFrames) {
+            DroppedFrameNum++;
+            return;
+         }
+         FrameWritten.wait( lock, [this]() { return static_cast<int>(EncodingFrames.size()) < QueueSize; } );
+      }
+      if (!FreeFrames.empty()) {
+         frame = std::move( FreeFrames.back() );
+         FreeFrames.pop_back();
+      }
+   }
+
+   frame.create( Height, Width, CV_8UC4 );
+   const auto buffer_size = static_cast<GLsizeiptr>(Width) * Height * 4;
+   const auto* pixels = static_cast<const uchar*>(glMapNamedBufferRange( pack.Buffer, 0, buffer_size, GL_MAP_READ_BIT ));
+   if (pixels == nullptr) {
+      DroppedFrameNum++;
+      return;
+   }
+   std::copy( pixels, pixels + buffer_size, frame.data );
+   glUnmapNamedBuffer( pack.Buffer );
+
+   {
+      std::lock_guard<std::mutex> lock(QueueLock);
+      EncodingFrames.push( std::move( frame ) );
+   }
+   FrameQueued.notify_one();
+}
+
+void FrameRecorder::encode()
+{
+   cv::Mat converted;
+   while (true) {
+      cv::Mat frame;
+      {
+         // The queue is drained before the encoder stops, so no captured frame is lost.
+         std::unique_lock<std::mutex> lock(QueueLock);
+         FrameQueued.wait( lock, [this]() { return StopEncoding || !EncodingFrames.empty(); } );
+         if (EncodingFrames.empty()) return;
+
+         frame = std::move( EncodingFrames.front() );
+         EncodingFrames.pop();
+      }
+
+      // OpenGL reads the bottom row first.
+      constexpr std::array<int, 6> bgra_to_bgr{ 0, 0, 1, 1, 2, 2 };
+      converted.create( Height, Width, CV_8UC3 );
+      cv::mixChannels( &frame, 1, &converted, 1, bgra_to_bgr.data(), 3 );
+      cv::flip( converted, converted, 0 );
+      const uint64_t frame_index = WrittenFrameNum.load( std::memory_order_relaxed );
+      if (IsVideo) Video.write( converted );
+      else {
+         std::ostringstream file_name;
+         file_name << OutputPath << "/frame_" << std::setw( 6 ) << std::setfill( '0' ) << frame_index << ".png";
+         if (!cv::imwrite( file_name.str(), converted )) std::cout << "Cannot Write " << file_name.str() << "...\n";
+      }
+      WrittenFrameNum.store( frame_index + 1, std::memory_order_relaxed );
+
+      {
+         std::lock_guard<std::mutex> lock(QueueLock);
+         FreeFrames.emplace_back( std::move( frame ) );
+      }
+      FrameWritten.notify_one();
+   }
+}
+
+void FrameRecorder::stop()
+{
+   if (!isRecording()) return;
+
+   while (ReadIndex < WriteIndex) retireOldestBuffer( true );
+   {
+      std::lock_guard<std::mutex> lock(QueueLock);
+      StopEncoding = true;
+   }
+   FrameQueued.notify_all();
+   Encoder.join();
+
+   for (auto& pack : PackBuffers) glDeleteBuffers( 1, &pack.Buffer );
+   PackBuffers.clear();
+   FreeFrames.clear();
+   if (Video.isOpened()) Video.release();
+}
+
+void FrameRecorder::printStatistics() const
+{
+   std::cout << " - Recorded Frames: " << WrittenFrameNum.load( std::memory_order_relaxed ) << " / " << CapturedFrameNum
+      << " captured (" << OutputPath << ")\n";
+   std::cout << " - Readback Stalls (ring full): " << ReadbackStallNum << "\n";
+   std::cout << " - Dropped Frames (encoder behind): " << DroppedFrameNum << "\n";
+}
@@ -0,0 +1,178 @@
+#include "FrameSource.h"
+
+FrameSource::FrameSource(int queue_size) :
+   QueueSize( std::max( queue_size, 2 ) ), IsLooping( false ), Frames( QueueSize ), WriteIndex( 0 ), ReadIndex( 0 ),
+   StopDecoding( false ), EndOfStream( false ), DecodedFrameNum( 0 ), DecodeTimeInNs( 0 ), TimedFrameNum( 0 ),
+   StalledFrameNum( 0 ),
+   Timestamps( QueueSize, 0.0 ), TimelineOffsets( QueueSize, 0.0 ), PresentedTimelineOffset( 0.0 ),
+   Epochs( QueueSize, 0 ), Epoch( 0 ), SeekRequest( 0 ), AcquiredIndex( 0 ), DroppedFrameNum( 0 ),
+   StarvedFrameNum( 0 ), PresentedFrameNum( 0 ), RepeatedFrameNum( 0 )
+{
+}
+
+int FrameSource::ClipInfo::clampFrameIndex(int frame_index) const
+{
+   return FrameCount > 0 ? std::clamp( frame_index, 0, FrameCount - 1 ) : std::max( frame_index, 0 );
+}
+
+int FrameSource::ClipInfo::getFrameIndex(double time_in_ms) const
+{
+   return clampFrameIndex( static_cast<int>(std::round( (time_in_ms - FirstFrameTime) * FPS / 1000.0 )) );
+}
+
+void FrameSource::start(const cv::Mat& first_frame, uint64_t first_index)
+{
+   for (auto& frame : Frames) frame.create( first_frame.rows, first_frame.cols, first_frame.type() );
+   std::fill( TimelineOffsets.begin(), TimelineOffsets.end(), 0.0 );
+   std::fill( Epochs.begin(), Epochs.end(), 0u );
+   PresentedTimelineOffset = 0.0;
+   Epoch = 0;
+   SeekRequest.store( 0, std::memory_order_relaxed );
+   WriteIndex.store( first_index, std::memory_order_relaxed );
+   ReadIndex.store( first_index, std::memory_order_relaxed );
+   AcquiredIndex = first_index;
+   StopDecoding.store( false, std::memory_order_relaxed );
+   EndOfStream.store( false, std::memory_order_relaxed );
+   DecodedFrameNum.store( 1, std::memory_order_relaxed );
+   DecodeTimeInNs.store( 0, std::memory_order_relaxed );
+   TimedFrameNum.store( 0, std::memory_order_relaxed );
+   DroppedFrameNum.store( 0, std::memory_order_relaxed );
+   StalledFrameNum.store( 0, std::memory_order_relaxed );
+   StarvedFrameNum.store( 0, std::memory_order_relaxed );
+   PresentedFrameNum = 1;
+   RepeatedFrameNum = 0;
+   Worker = std::thread( &FrameSource::decode, this );
+}
+
+void FrameSource::close()
+{
+   if (Worker.joinable()) {
+      StopDecoding.store( true, std::memory_order_release );
+      Worker.join();
+   }
+}
+
+double FrameSource::seekToFrame(int frame_index)
+{
+   // Frames produced before the seek are tagged with the old epoch, so the render thread discards them
+   // without waiting for the producer to flush the ring. The seek addresses the clip which is being produced.
+   frame_index = Clip.clampFrameIndex( frame_index );
+   Epoch++;
+   SeekRequest.store( static_cast<uint64_t>(Epoch) << 32 | static_cast<uint32_t>(frame_index), std::memory_order_release );
+   return Clip.getFrameTime( frame_index );
+}
+
+double FrameSource::seekToTime(double time_in_ms)
+{
+   return seekToFrame( Clip.getFrameIndex( time_in_ms ) );
+}
+
+bool FrameSource::takeSeekRequest(uint32_t& epoch, int& frame_index)
+{
+   const uint64_t seek_request = SeekRequest.exchange( 0, std::memory_order_acq_rel );
+   if (seek_request == 0) return false;
+
+   epoch = static_cast<uint32_t>(seek_request >> 32);
+   frame_index = static_cast<int>(seek_request & 0xFFFFFFFFu);
+   EndOfStream.store( false, std::memory_order_release );
+   return true;
+}
+
+bool FrameSource::waitForFreeSlot(uint64_t write_index)
+{
+   StalledFrameNum.fetch_add( 1, std::memory_order_relaxed );
+   do {
+      std::this_thread::sleep_for( std::chrono::milliseconds(1) );
+      if (StopDecoding.load( std::memory_order_acquire )) return false;
+   } while (isRingFull( write_index ) && SeekRequest.load( std::memory_order_acquire ) == 0);
+   return true;
+}
+
+void FrameSource::commitFrame(uint64_t write_index, double timestamp, double timeline_offset, uint32_t epoch)
+{
+   const auto slot = static_cast<size_t>(write_index % static_cast<uint64_t>(QueueSize));
+   Timestamps[slot] = timestamp;
+   TimelineOffsets[slot] = timeline_offset;
+   Epochs[slot] = epoch;
+   WriteIndex.store( write_index + 1, std::memory_order_release );
+}
+
+void FrameSource::addDecodeTime(std::chrono::steady_clock::duration decode_time)
+{
+   DecodeTimeInNs.fetch_add(
+      static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(decode_time).count()),
+      std::memory_order_relaxed
+   );
+   TimedFrameNum.fetch_add( 1, std::memory_order_relaxed );
+}
+
+const cv::Mat* FrameSource::acquireFrame(double presentation_time_in_ms)
+{
+   const auto queue_size = static_cast<uint64_t>(QueueSize);
+   const uint64_t write_index = WriteIndex.load( std::memory_order_acquire );
+   uint64_t read_index = ReadIndex.load( std::memory_order_relaxed );
+   if (read_index < write_index && Epochs[read_index % queue_size] != Epoch) {
+      while (read_index < write_index && Epochs[read_index % queue_size] != Epoch) read_index++;
+      ReadIndex.store( read_index, std::memory_order_release );
+   }
+   if (write_index == read_index) {
+      if (!EndOfStream.load( std::memory_order_acquire )) StarvedFrameNum.fetch_add( 1, std::memory_order_relaxed );
+      return nullptr;
+   }
+   if (Timestamps[read_index % queue_size] > presentation_time_in_ms) {
+      RepeatedFrameNum++;
+      return nullptr;
+   }
+
+   // Skip the frames which are already late, but keep the newest due slot reserved until releaseFrame() is called.
+   // A discarded slot is not acquired; it is skipped above once it reaches the front of the ring.
+   AcquiredIndex = read_index;
+   while (AcquiredIndex + 1 < write_index && Timestamps[(AcquiredIndex + 1) % queue_size] <= presentation_time_in_ms &&
+          Epochs[(AcquiredIndex + 1) % queue_size] == Epoch) {
+      AcquiredIndex++;
+   }
+   if (AcquiredIndex > read_index) {
+      DroppedFrameNum.fetch_add( AcquiredIndex - read_index, std::memory_order_relaxed );
+      ReadIndex.store( AcquiredIndex, std::memory_order_release );
+   }
+   PresentedFrameNum++;
+   PresentedTimelineOffset = TimelineOffsets[AcquiredIndex % queue_size];
+   return &Frames[AcquiredIndex % queue_size];
+}
+
+const cv::Mat* FrameSource::waitForFrame(double presentation_time_in_ms)
+{
+   const auto queue_size = static_cast<uint64_t>(QueueSize);
+   while (Worker.joinable() && !EndOfStream.load( std::memory_order_acquire )) {
+      const uint64_t write_index = WriteIndex.load( std::memory_order_acquire );
+      const uint64_t read_index = ReadIndex.load( std::memory_order_relaxed );
+      if (write_index > read_index && Timestamps[(write_index - 1) % queue_size] > presentation_time_in_ms) break;
+      if (write_index - read_index >= queue_size) {
+         // Every frame of the full ring is due, so all but the newest would be dropped anyway.
+         DroppedFrameNum.fetch_add( write_index - 1 - read_index, std::memory_order_relaxed );
+         ReadIndex.store( write_index - 1, std::memory_order_release );
+         continue;
+      }
+      std::this_thread::sleep_for( std::chrono::milliseconds(1) );
+   }
+   return acquireFrame( presentation_time_in_ms );
+}
+
+void FrameSource::releaseFrame()
+{
+   ReadIndex.store( AcquiredIndex + 1, std::memory_order_release );
+}
+
+void FrameSource::printStatistics() const
+{
+   std::cout << " - Decoded Frames: " << getDecodedFrameNum() << " (" << Clip.FPS << " fps)\n";
+   if (TimedFrameNum.load( std::memory_order_relaxed ) > 0) {
+      std::cout << " - Mean Decode Time: " << getMeanDecodeTime() << " ms\n";
+   }
+   std::cout << " - Presented Frames: " << PresentedFrameNum << "\n";
+   std::cout << " - Repeated Frames (not due yet): " << RepeatedFrameNum << "\n";
+   std::cout << " - Queue Depth: " << getQueueDepth() << " / " << QueueSize << "\n";
+   std::cout << " - Dropped Frames (late): " << getDroppedFrameNum() << "\n";
+   std::cout << " - Decoder Stalls (queue full): " << getStalledFrameNum() << "\n";
+   std::cout << " - Renderer Starvations (queue empty): " << getStarvedFrameNum() << "\n";
+}
@@ -0,0 +1,94 @@
+#include "HeadlessContext.h"
+
+#ifdef USE_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+HeadlessContext::HeadlessContext() : Display( nullptr ), Context( nullptr )
+{
+}
+
+HeadlessContext::~HeadlessContext()
+{
+   destroy();
+}
+
+#ifdef USE_EGL
+bool HeadlessContext::create(int major_version, int minor_version)
+{
+   destroy();
+
+   // The surfaceless platform needs no X or Wayland server; the default display is the fallback for older drivers.
+   const auto get_platform_display = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+      eglGetProcAddress( "eglGetPlatformDisplayEXT" )
+   );
+   EGLDisplay display = get_platform_display != nullptr ?
+      get_platform_display( EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr ) : EGL_NO_DISPLAY;
+   if (display == EGL_NO_DISPLAY) display = eglGetDisplay( EGL_DEFAULT_DISPLAY );
+   if (display == EGL_NO_DISPLAY || eglInitialize( display, nullptr, nullptr ) == EGL_FALSE) {
+      std::cout << "Cannot Initialize EGL...\n";
+      return false;
+   }
+   Display = display;
+
+   // The surfaceless display may expose no configs at all, then the context is created without one.
+   const EGLint config_attributes[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+   EGLConfig config = EGL_NO_CONFIG_KHR;
+   EGLint config_num = 0;
+   if (eglChooseConfig( display, config_attributes, &config, 1, &config_num ) == EGL_FALSE || config_num == 0) {
+      config = EGL_NO_CONFIG_KHR;
+   }
+
+   const EGLint context_attributes[] = {
+      EGL_CONTEXT_MAJOR_VERSION, major_version,
+      EGL_CONTEXT_MINOR_VERSION, minor_version,
+      EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+      EGL_NONE
+   };
+   EGLContext context = EGL_NO_CONTEXT;
+   if (eglBindAPI( EGL_OPENGL_API ) == EGL_TRUE) {
+      context = eglCreateContext( display, config, EGL_NO_CONTEXT, context_attributes );
+   }
+   if (context == EGL_NO_CONTEXT || eglMakeCurrent( display, EGL_NO_SURFACE, EGL_NO_SURFACE, context ) == EGL_FALSE) {
+      std::cout << "Cannot Create an OpenGL " << major_version << "." << minor_version << " Context with EGL...\n";
+      if (context != EGL_NO_CONTEXT) eglDestroyContext( display, context );
+      destroy();
+      return false;
+   }
+   Context = context;
+   return true;
+}
+
+void HeadlessContext::destroy()
+{
+   if (Display == nullptr) return;
+
+   eglMakeCurrent( Display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT );
+   if (Context != nullptr) eglDestroyContext( Display, Context );
+   eglTerminate( Display );
+   Context = nullptr;
+   Display = nullptr;
+}
+
+void* HeadlessContext::getProcAddress(const char* name)
+{
+   return reinterpret_cast<void*>(eglGetProcAddress( name ));
+}
+#else
+bool HeadlessContext::create(int major_version, int minor_version)
+{
+   std::cout << "Cannot Create an OpenGL " << major_version << "." << minor_version
+      << " Context without a window; the build has no EGL...\n";
+   return false;
+}
+
+void HeadlessContext::destroy()
+{
+}
+
+void* HeadlessContext::getProcAddress(const char* /*name*/)
+{
+   return nullptr;
+}
+#endif
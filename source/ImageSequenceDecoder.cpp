@@ -0,0 +1,168 @@
+#include "ImageSequenceDecoder.h"
+#include "MappedFile.h"
+
+ImageSequenceDecoder::ImageSequenceDecoder(double fps, int thread_num, int queue_size) :
+   FrameSource( queue_size > 0 ? queue_size : 2 * std::max( static_cast<int>(std::thread::hardware_concurrency()), 2 ) ),
+   FPS( fps > 0.0 ? fps : 30.0 ), FailedFrameNum( 0 ),
+   Decoders( std::make_unique<ThreadPool>(
+      thread_num > 0 ? thread_num : std::max( static_cast<int>(std::thread::hardware_concurrency()) - 1, 1 )
+   ) )
+{
+}
+
+ImageSequenceDecoder::~ImageSequenceDecoder()
+{
+   close();
+}
+
+std::vector<std::string> ImageSequenceDecoder::getFramePaths(const std::string& directory_path)
+{
+   static const std::vector<std::string> extensions = {
+      ".png", ".jpg", ".jpeg", ".bmp", ".tif", ".tiff", ".exr", ".webp"
+   };
+
+   std::vector<std::string> frame_paths;
+   std::error_code error;
+   for (const auto& entry : std::filesystem::directory_iterator( directory_path, error )) {
+      if (!entry.is_regular_file()) continue;
+
+      std::string extension = entry.path().extension().string();
+      std::transform( extension.begin(), extension.end(), extension.begin(), ::tolower );
+      if (std::find( extensions.begin(), extensions.end(), extension ) != extensions.end()) {
+         frame_paths.emplace_back( entry.path().string() );
+      }
+   }
+
+   // Numbers are not always zero-padded, so frame_10 has to come after frame_9.
+   std::sort(
+      frame_paths.begin(), frame_paths.end(),
+      [](const std::string& a, const std::string& b)
+      {
+         return a.size() != b.size() ? a.size() < b.size() : a < b;
+      }
+   );
+   return frame_paths;
+}
+
+bool ImageSequenceDecoder::decodeFrame(const std::string& frame_path, cv::Mat& frame, ImageSequenceDecoder* source)
+{
+   MappedFile file;
+   if (!file.open( frame_path )) return false;
+
+   // The mapped file is wrapped without a copy, and the frame is decoded into the destination if it has the same layout.
+   const cv::Mat encoded(1, static_cast<int>(file.getSize()), CV_8UC1, const_cast<uint8_t*>(file.getData()));
+   const auto decode_start_time = std::chrono::steady_clock::now();
+   cv::imdecode( encoded, cv::IMREAD_COLOR, &frame );
+   if (frame.empty()) return false;
+
+   if (source != nullptr) source->addDecodeTime( std::chrono::steady_clock::now() - decode_start_time );
+   return true;
+}
+
+bool ImageSequenceDecoder::open(const std::string& directory_path, cv::Mat& first_frame, bool /*use_planar_yuv*/)
+{
+   close();
+
+   FramePaths = getFramePaths( directory_path );
+   if (FramePaths.empty() || !decodeFrame( FramePaths[0], first_frame )) {
+      std::cout << "Cannot Read Image Sequence...\n";
+      return false;
+   }
+
+   Clip.Format = BGR;
+   Clip.Width = first_frame.cols;
+   Clip.Height = first_frame.rows;
+   Clip.FPS = FPS;
+   Clip.FirstFrameTime = 0.0;
+   Clip.FrameCount = static_cast<int>(FramePaths.size());
+   FailedFrameNum.store( 0, std::memory_order_relaxed );
+   start( first_frame );
+   return true;
+}
+
+void ImageSequenceDecoder::decode()
+{
+   struct Job
+   {
+      std::future<bool> IsDecoded;
+      double Timestamp;
+      double TimelineOffset;
+      uint32_t Epoch;
+   };
+
+   const auto queue_size = static_cast<uint64_t>(QueueSize);
+   const double duration = static_cast<double>(Clip.FrameCount) * 1000.0 / Clip.FPS;
+   std::deque<Job> jobs;
+   uint64_t submit_index = WriteIndex.load( std::memory_order_relaxed );
+   int frame_index = 1;
+   double timeline_offset = 0.0;
+   uint32_t epoch = 0;
+   while (!StopDecoding.load( std::memory_order_acquire )) {
+      if (takeSeekRequest( epoch, frame_index )) {
+         // Frames in flight finish and are committed with the old epoch, so the render thread skips them.
+         frame_index = Clip.clampFrameIndex( frame_index );
+         timeline_offset = 0.0;
+      }
+
+      // A slot is free once the render thread has moved ReadIndex past it, so the workers decode into it directly.
+      bool has_reached_end = false;
+      while (!isRingFull( submit_index )) {
+         if (frame_index >= Clip.FrameCount) {
+            if (!isLooping()) {
+               has_reached_end = true;
+               break;
+            }
+            timeline_offset += duration;
+            frame_index = 0;
+         }
+         cv::Mat* frame = &Frames[submit_index % queue_size];
+         jobs.push_back(
+            {
+               Decoders->submit(
+                  [this, frame, &path = FramePaths[frame_index]]() { return decodeFrame( path, *frame, this ); }
+               ),
+               timeline_offset + Clip.getFrameTime( frame_index ),
+               timeline_offset,
+               epoch
+            }
+         );
+         frame_index++;
+         submit_index++;
+      }
+
+      if (jobs.empty()) {
+         if (has_reached_end) {
+            EndOfStream.store( true, std::memory_order_release );
+            std::this_thread::sleep_for( std::chrono::milliseconds(1) );
+         }
+         else if (!waitForFreeSlot( submit_index )) break;
+         continue;
+      }
+
+      // The oldest frame is committed first, while the newer ones keep decoding on the other workers.
+      Job& job = jobs.front();
+      if (job.IsDecoded.wait_for( std::chrono::milliseconds(1) ) != std::future_status::ready) continue;
+      // A frame which cannot be decoded keeps its slot, so the frames in flight stay in their slots,
+      // but the slot is discarded and the previous frame stays on screen instead.
+      const uint64_t write_index = WriteIndex.load( std::memory_order_relaxed );
+      if (job.IsDecoded.get()) {
+         DecodedFrameNum.fetch_add( 1, std::memory_order_relaxed );
+         commitFrame( write_index, job.Timestamp, job.TimelineOffset, job.Epoch );
+      }
+      else {
+         FailedFrameNum.fetch_add( 1, std::memory_order_relaxed );
+         discardFrame( write_index, job.Timestamp, job.TimelineOffset );
+      }
+      jobs.pop_front();
+   }
+
+   // The workers write into the ring, so they have to finish before it can be reallocated.
+   for (auto& job : jobs) job.IsDecoded.wait();
+}
+
+void ImageSequenceDecoder::printStatistics() const
+{
+   FrameSource::printStatistics();
+   std::cout << " - Decoding Threads: " << Decoders->getThreadNum() << "\n";
+   std::cout << " - Failed Frames: " << getFailedFrameNum() << "\n";
+}
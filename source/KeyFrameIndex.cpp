@@ -0,0 +1,159 @@
+#include "KeyFrameIndex.h"
+
+namespace
+{
+   constexpr uint32_t getBoxType(const char (&name)[5])
+   {
+      return static_cast<uint32_t>(static_cast<uint8_t>(name[0])) << 24 |
+         static_cast<uint32_t>(static_cast<uint8_t>(name[1])) << 16 |
+         static_cast<uint32_t>(static_cast<uint8_t>(name[2])) << 8 |
+         static_cast<uint32_t>(static_cast<uint8_t>(name[3]));
+   }
+
+   uint32_t readUint32(const uint8_t* p)
+   {
+      return static_cast<uint32_t>(p[0]) << 24 | static_cast<uint32_t>(p[1]) << 16 |
+         static_cast<uint32_t>(p[2]) << 8 | static_cast<uint32_t>(p[3]);
+   }
+
+   // Moves to the box after the current one, and returns false at the end or on a box which overruns its parent.
+   bool readBox(const uint8_t*& p, const uint8_t* end, uint32_t& type, const uint8_t*& body, const uint8_t*& body_end)
+   {
+      if (end - p < 8) return false;
+      uint64_t size = readUint32( p );
+      type = readUint32( p + 4 );
+      body = p + 8;
+      if (size == 1) {
+         if (end - p < 16) return false;
+         size = static_cast<uint64_t>(readUint32( p + 8 )) << 32 | readUint32( p + 12 );
+         body = p + 16;
+      }
+      else if (size == 0) size = static_cast<uint64_t>(end - p);
+      if (size < static_cast<uint64_t>(body - p) || size > static_cast<uint64_t>(end - p)) return false;
+      body_end = p + size;
+      p = body_end;
+      return true;
+   }
+
+   const uint8_t* findBox(const uint8_t* p, const uint8_t* end, uint32_t type, const uint8_t*& body_end)
+   {
+      uint32_t box_type = 0;
+      const uint8_t* body = nullptr;
+      while (readBox( p, end, box_type, body, body_end )) {
+         if (box_type == type) return body;
+      }
+      return nullptr;
+   }
+}
+
+KeyFrameIndex::KeyFrameIndex() : IsBuilt( false ), AreAllFramesKey( false )
+{
+}
+
+void KeyFrameIndex::clear()
+{
+   IsBuilt = false;
+   AreAllFramesKey = false;
+   KeyFrames.clear();
+}
+
+bool KeyFrameIndex::readTrack(const uint8_t* data, const uint8_t* end)
+{
+   const uint8_t* media_end = nullptr;
+   const uint8_t* media = findBox( data, end, getBoxType( "mdia" ), media_end );
+   if (media == nullptr) return false;
+
+   // The handler box holds the version and flags, a reserved field and then the handler type.
+   const uint8_t* handler_end = nullptr;
+   const uint8_t* handler = findBox( media, media_end, getBoxType( "hdlr" ), handler_end );
+   if (handler == nullptr || handler_end - handler < 12 || readUint32( handler + 8 ) != getBoxType( "vide" )) {
+      return false;
+   }
+
+   const uint8_t* information_end = nullptr;
+   const uint8_t* information = findBox( media, media_end, getBoxType( "minf" ), information_end );
+   if (information == nullptr) return false;
+   const uint8_t* table_end = nullptr;
+   const uint8_t* table = findBox( information, information_end, getBoxType( "stbl" ), table_end );
+   if (table == nullptr) return false;
+
+   const uint8_t* sync_end = nullptr;
+   const uint8_t* sync = findBox( table, table_end, getBoxType( "stss" ), sync_end );
+   if (sync == nullptr) {
+      AreAllFramesKey = true;
+      return true;
+   }
+   if (sync_end - sync < 8) return false;
+
+   // Sync samples are numbered from 1 in the decoding order, which matches the display order at key frames.
+   const uint32_t entry_num = readUint32( sync + 4 );
+   if (static_cast<uint64_t>(entry_num) * 4 > static_cast<uint64_t>(sync_end - sync - 8)) return false;
+   KeyFrames.reserve( entry_num );
+   for (uint32_t i = 0; i < entry_num; ++i) {
+      const uint32_t sample = readUint32( sync + 8 + i * 4 );
+      if (sample > 0) KeyFrames.emplace_back( static_cast<int>(sample - 1) );
+   }
+   std::sort( KeyFrames.begin(), KeyFrames.end() );
+   return !KeyFrames.empty();
+}
+
+bool KeyFrameIndex::build(const std::string& video_path)
+{
+   clear();
+
+   std::ifstream file(video_path, std::ios::binary);
+   if (!file.is_open()) return false;
+
+   // Only the headers of the top-level boxes are read until the movie box, so the media data is never touched.
+   std::vector<uint8_t> movie;
+   std::array<uint8_t, 16> header{};
+   while (file.read( reinterpret_cast<char*>(header.data()), 8 )) {
+      uint64_t size = readUint32( header.data() );
+      uint64_t header_size = 8;
+      if (size == 1) {
+         if (!file.read( reinterpret_cast<char*>(header.data() + 8), 8 )) return false;
+         size = static_cast<uint64_t>(readUint32( header.data() + 8 )) << 32 | readUint32( header.data() + 12 );
+         header_size = 16;
+      }
+      if (size != 0 && size < header_size) return false;
+
+      if (readUint32( header.data() + 4 ) == getBoxType( "moov" )) {
+         if (size == 0) movie.assign( std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() );
+         else {
+            movie.resize( static_cast<size_t>(size - header_size) );
+            if (!file.read( reinterpret_cast<char*>(movie.data()), static_cast<std::streamsize>(movie.size()) )) {
+               return false;
+            }
+         }
+         break;
+      }
+      if (size == 0) return false;
+      file.seekg( static_cast<std::streamoff>(size - header_size), std::ios::cur );
+   }
+   if (movie.empty()) return false;
+
+   uint32_t type = 0;
+   const uint8_t* data = movie.data();
+   const uint8_t* end = movie.data() + movie.size();
+   const uint8_t* track = nullptr;
+   const uint8_t* track_end = nullptr;
+   while (readBox( data, end, type, track, track_end )) {
+      if (type != getBoxType( "trak" )) continue;
+      if (readTrack( track, track_end )) {
+         IsBuilt = true;
+         return true;
+      }
+      AreAllFramesKey = false;
+      KeyFrames.clear();
+   }
+   return false;
+}
+
+int KeyFrameIndex::getPrecedingKeyFrame(int frame_index) const
+{
+   if (!IsBuilt) return -1;
+   if (AreAllFramesKey) return frame_index;
+
+   const auto next = std::upper_bound( KeyFrames.begin(), KeyFrames.end(), frame_index );
+   return next == KeyFrames.begin() ? -1 : *std::prev( next );
+}
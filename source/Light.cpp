@@ -1,10 +1,24 @@
 #include "Light.h"
 
+static_assert( sizeof(LightGL::LightInfo) == 96, "LightInfo must match the std430 layout" );
+
 LightGL::LightGL() :
-   TurnLightOn( true ), GlobalAmbientColor( 0.2f, 0.2f, 0.2f, 1.0f ), TotalLightNum( 0 )
+   TurnLightOn( true ), TotalLightNum( 0 ), GlobalAmbientColor( 0.2f, 0.2f, 0.2f, 1.0f ), IsHeaderDirty( true ),
+   LightBuffer( 0 ), ViewLightBuffer( 0 ), LightGridBuffer( 0 ), LightIndexBuffer( 0 ), LightIndexNumBuffer( 0 ),
+   LightIndexNumFence( nullptr ), LightIndexCapacity( 0 ), LightCapacity( 0 )
 {
 }
 
+LightGL::~LightGL()
+{
+   if (LightBuffer != 0) glDeleteBuffers( 1, &LightBuffer );
+   if (ViewLightBuffer != 0) glDeleteBuffers( 1, &ViewLightBuffer );
+   if (LightGridBuffer != 0) glDeleteBuffers( 1, &LightGridBuffer );
+   if (LightIndexBuffer != 0) glDeleteBuffers( 1, &LightIndexBuffer );
+   if (LightIndexNumBuffer != 0) glDeleteBuffers( 1, &LightIndexNumBuffer );
+   if (LightIndexNumFence != nullptr) glDeleteSync( LightIndexNumFence );
+}
+
 bool LightGL::isLightOn() const
 {
    return TurnLightOn;
@@ -13,6 +27,7 @@ bool LightGL::isLightOn() const
 void LightGL::toggleLightSwitch()
 {
    TurnLightOn = !TurnLightOn;
+   IsHeaderDirty = true;
 }
 
 void LightGL::addLight(
@@ -26,49 +41,186 @@ void LightGL::addLight(
    float falloff_radius
 )
 {
-   Positions.emplace_back( light_position );
+   LightInfo light{};
+   light.Position = light_position;
+
+   light.AmbientColor = ambient_color;
+   light.DiffuseColor = diffuse_color;
+   light.SpecularColor = specular_color;
 
-   AmbientColors.emplace_back( ambient_color );
-   DiffuseColors.emplace_back( diffuse_color );
-   SpecularColors.emplace_back( specular_color );
+   light.SpotlightDirection = spotlight_direction;
+   light.SpotlightCutoffAngle = spotlight_cutoff_angle_in_degree;
+   light.SpotlightFeather = spotlight_feather;
+   light.FallOffRadius = falloff_radius;
 
-   SpotlightDirections.emplace_back( spotlight_direction );
-   SpotlightCutoffAngles.emplace_back( spotlight_cutoff_angle_in_degree );
-   SpotlightFeathers.emplace_back( spotlight_feather );
-   FallOffRadii.emplace_back( falloff_radius );
+   light.LightSwitch = 1;
 
-   IsActivated.emplace_back( true );
+   Lights.emplace_back( light );
+   IsDirty.emplace_back( true );
+   IsHeaderDirty = true;
 
-   TotalLightNum = static_cast<int>(Positions.size());
+   TotalLightNum = static_cast<int>(Lights.size());
 }
 
 void LightGL::activateLight(const int& light_index)
 {
    if (light_index >= TotalLightNum) return;
-   IsActivated[light_index] = true;
+   Lights[light_index].LightSwitch = 1;
+   IsDirty[light_index] = true;
 }
 
 void LightGL::deactivateLight(const int& light_index)
 {
    if (light_index >= TotalLightNum) return;
-   IsActivated[light_index] = false;
+   Lights[light_index].LightSwitch = 0;
+   IsDirty[light_index] = true;
+}
+
+void LightGL::truncateLights(int light_num)
+{
+   if (light_num < 0 || light_num >= TotalLightNum) return;
+   Lights.resize( light_num );
+   IsDirty.resize( light_num );
+   IsHeaderDirty = true;
+   TotalLightNum = light_num;
+}
+
+void LightGL::reallocateLightBuffer()
+{
+   // The storage is immutable, so a buffer with double the capacity replaces it and every light is uploaded again.
+   LightCapacity = std::max( LightCapacity * 2, std::max( TotalLightNum, 16 ) );
+   if (LightBuffer != 0) glDeleteBuffers( 1, &LightBuffer );
+   glCreateBuffers( 1, &LightBuffer );
+   glNamedBufferStorage(
+      LightBuffer,
+      static_cast<GLsizeiptr>(sizeof(LightHeader) + sizeof(LightInfo) * LightCapacity),
+      nullptr,
+      GL_DYNAMIC_STORAGE_BIT
+   );
+
+   // Each light in the eye coordinates is a position and a spotlight direction.
+   if (ViewLightBuffer != 0) glDeleteBuffers( 1, &ViewLightBuffer );
+   glCreateBuffers( 1, &ViewLightBuffer );
+   glNamedBufferStorage(
+      ViewLightBuffer, static_cast<GLsizeiptr>(sizeof(glm::vec4) * 2 * LightCapacity), nullptr, 0
+   );
+   std::fill( IsDirty.begin(), IsDirty.end(), true );
+   IsHeaderDirty = true;
+}
+
+void LightGL::transferLightsToShader()
+{
+   if (LightBuffer == 0 || TotalLightNum > LightCapacity) reallocateLightBuffer();
+
+   if (IsHeaderDirty) {
+      LightHeader header{};
+      header.GlobalAmbient = GlobalAmbientColor;
+      header.UseLight = TurnLightOn ? 1 : 0;
+      header.LightNum = TotalLightNum;
+      glNamedBufferSubData( LightBuffer, 0, sizeof(LightHeader), &header );
+      IsHeaderDirty = false;
+   }
+
+   // Consecutive changed lights are uploaded with one call.
+   for (int i = 0; i < TotalLightNum;) {
+      if (!IsDirty[i]) {
+         ++i;
+         continue;
+      }
+
+      int end = i;
+      while (end < TotalLightNum && IsDirty[end]) IsDirty[end++] = false;
+      glNamedBufferSubData(
+         LightBuffer,
+         static_cast<GLintptr>(sizeof(LightHeader) + sizeof(LightInfo) * i),
+         static_cast<GLsizeiptr>(sizeof(LightInfo) * (end - i)),
+         &Lights[i]
+      );
+      i = end;
+   }
+   glBindBufferBase( GL_SHADER_STORAGE_BUFFER, LIGHT_BUFFER_BINDING, LightBuffer );
+}
+
+void LightGL::transformLightsToView(const ShaderGL* culling_shader) const
+{
+   glUseProgram( culling_shader->getComputeShaderProgram( TRANSFORM_LIGHTS ) );
+   glBindBufferBase( GL_SHADER_STORAGE_BUFFER, VIEW_LIGHT_BUFFER_BINDING, ViewLightBuffer );
+   glDispatchCompute( static_cast<GLuint>(std::max( (TotalLightNum + 63) / 64, 1 )), 1, 1 );
+   glMemoryBarrier( GL_SHADER_STORAGE_BARRIER_BIT );
+}
+
+void LightGL::reallocateLightIndexBuffer(GLuint capacity)
+{
+   LightIndexCapacity = capacity;
+   if (LightIndexBuffer != 0) glDeleteBuffers( 1, &LightIndexBuffer );
+   glCreateBuffers( 1, &LightIndexBuffer );
+   glNamedBufferStorage( LightIndexBuffer, static_cast<GLsizeiptr>(sizeof(GLuint)) * capacity, nullptr, 0 );
+   glNamedBufferSubData(
+      LightGridBuffer, offsetof( LightGridHeader, LightIndexCapacity ), sizeof(GLuint), &LightIndexCapacity
+   );
 }
 
-void LightGL::transferUniformsToShader(const ShaderGL* shader)
+void LightGL::growLightIndexBuffer()
 {
-   glUniform1i( shader->getLightAvailabilityLocation(), TurnLightOn ? 1 : 0 );
-   glUniform1i( shader->getLightNumLocation(), static_cast<GLint>(TotalLightNum) );
-   glUniform4fv( shader->getGlobalAmbientLocation(), 1, &GlobalAmbientColor[0] );
-
-   for (int i = 0; i < TotalLightNum; ++i) {
-      glUniform1i( shader->getLightSwitchLocation( i ), IsActivated[0] ? 1 : 0 );
-      glUniform4fv( shader->getLightPositionLocation( i ), 1, &Positions[i][0] );
-      glUniform4fv( shader->getLightAmbientLocation( i ), 1, &AmbientColors[i][0] );
-      glUniform4fv( shader->getLightDiffuseLocation( i ), 1, &DiffuseColors[i][0] );
-      glUniform4fv( shader->getLightSpecularLocation( i ), 1, &SpecularColors[i][0] );
-      glUniform3fv( shader->getLightSpotlightDirectionLocation( i ), 1, &SpotlightDirections[i][0] );
-      glUniform1f( shader->getLightSpotlightCutoffAngleLocation( i ), SpotlightCutoffAngles[i] );
-      glUniform1f( shader->getLightSpotlightFeatherLocation( i ), SpotlightFeathers[i] );
-      glUniform1f( shader->getLightFallOffRadiusLocation( i ), FallOffRadii[i] );
+   // The copy of an earlier frame is read once it is done, so the CPU never waits for the GPU here.
+   if (LightIndexNumFence == nullptr) return;
+   const GLenum status = glClientWaitSync( LightIndexNumFence, 0, 0 );
+   if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) return;
+   glDeleteSync( LightIndexNumFence );
+   LightIndexNumFence = nullptr;
+
+   GLuint light_index_num = 0;
+   glGetNamedBufferSubData( LightIndexNumBuffer, 0, sizeof(GLuint), &light_index_num );
+   if (light_index_num > LightIndexCapacity) reallocateLightIndexBuffer( light_index_num + light_index_num / 2 );
+}
+
+void LightGL::cullLights(const ShaderGL* culling_shader)
+{
+   if (LightGridBuffer == 0) {
+      // Every cluster starts with room for a few lights, and the list grows with the lights.
+      constexpr GLuint initial_lights_per_cluster = 16;
+      glCreateBuffers( 1, &LightGridBuffer );
+      glNamedBufferStorage(
+         LightGridBuffer,
+         static_cast<GLsizeiptr>(sizeof(LightGridHeader) + sizeof(glm::uvec2) * ClusterNum),
+         nullptr,
+         GL_DYNAMIC_STORAGE_BIT
+      );
+      glCreateBuffers( 1, &LightIndexNumBuffer );
+      glNamedBufferStorage( LightIndexNumBuffer, sizeof(GLuint), nullptr, 0 );
+      reallocateLightIndexBuffer( ClusterNum * initial_lights_per_cluster );
    }
-}
\ No newline at end of file
+   else growLightIndexBuffer();
+
+   glBindBufferBase( GL_SHADER_STORAGE_BUFFER, LIGHT_GRID_BINDING, LightGridBuffer );
+   glBindBufferBase( GL_SHADER_STORAGE_BUFFER, LIGHT_INDEX_BINDING, LightIndexBuffer );
+   glUseProgram( culling_shader->getComputeShaderProgram( COUNT_LIGHTS ) );
+   glDispatchCompute( ClusterNumX, ClusterNumY, ClusterNumZ );
+   glMemoryBarrier( GL_SHADER_STORAGE_BARRIER_BIT );
+   glUseProgram( culling_shader->getComputeShaderProgram( OFFSET_LIGHT_LISTS ) );
+   glDispatchCompute( 1, 1, 1 );
+   glMemoryBarrier( GL_SHADER_STORAGE_BARRIER_BIT );
+   glUseProgram( culling_shader->getComputeShaderProgram( CULL_LIGHTS ) );
+   glDispatchCompute( ClusterNumX, ClusterNumY, ClusterNumZ );
+   glMemoryBarrier( GL_SHADER_STORAGE_BARRIER_BIT );
+
+   if (LightIndexNumFence == nullptr) {
+      glMemoryBarrier( GL_BUFFER_UPDATE_BARRIER_BIT );
+      glCopyNamedBufferSubData(
+         LightGridBuffer, LightIndexNumBuffer, offsetof( LightGridHeader, LightIndexNum ), 0, sizeof(GLuint)
+      );
+      LightIndexNumFence = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+   }
+}
+
+GLuint LightGL::getLightIndexNum() const
+{
+   if (LightGridBuffer == 0) return 0;
+
+   GLuint light_index_num = 0;
+   glMemoryBarrier( GL_BUFFER_UPDATE_BARRIER_BIT );
+   glGetNamedBufferSubData(
+      LightGridBuffer, offsetof( LightGridHeader, LightIndexNum ), sizeof(GLuint), &light_index_num
+   );
+   return light_index_num;
+}
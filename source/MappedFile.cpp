@@ -0,0 +1,102 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+MappedFile::MappedFile() : Data( nullptr ), Size( 0 ), FileHandle( INVALID_HANDLE_VALUE ), MappingHandle( nullptr )
+{
+}
+#else
+MappedFile::MappedFile() : Data( nullptr ), Size( 0 ), FileDescriptor( -1 )
+{
+}
+#endif
+
+MappedFile::~MappedFile()
+{
+   close();
+}
+
+#ifdef _WIN32
+bool MappedFile::open(const std::string& file_path)
+{
+   close();
+
+   FileHandle = CreateFileA(
+      file_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr
+   );
+   if (FileHandle == INVALID_HANDLE_VALUE) return false;
+
+   LARGE_INTEGER file_size;
+   if (!GetFileSizeEx( FileHandle, &file_size ) || file_size.QuadPart == 0) {
+      close();
+      return false;
+   }
+   MappingHandle = CreateFileMappingA( FileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr );
+   if (MappingHandle == nullptr) {
+      close();
+      return false;
+   }
+   Data = static_cast<const uint8_t*>(MapViewOfFile( MappingHandle, FILE_MAP_READ, 0, 0, 0 ));
+   if (Data == nullptr) {
+      close();
+      return false;
+   }
+   Size = static_cast<size_t>(file_size.QuadPart);
+   return true;
+}
+
+void MappedFile::close()
+{
+   if (Data != nullptr) UnmapViewOfFile( Data );
+   if (MappingHandle != nullptr) CloseHandle( MappingHandle );
+   if (FileHandle != INVALID_HANDLE_VALUE) CloseHandle( FileHandle );
+   Data = nullptr;
+   Size = 0;
+   MappingHandle = nullptr;
+   FileHandle = INVALID_HANDLE_VALUE;
+}
+#else
+bool MappedFile::open(const std::string& file_path)
+{
+   close();
+
+   FileDescriptor = ::open( file_path.c_str(), O_RDONLY );
+   if (FileDescriptor < 0) return false;
+
+   struct stat file_status{};
+   if (fstat( FileDescriptor, &file_status ) != 0 || file_status.st_size == 0) {
+      close();
+      return false;
+   }
+   void* data = mmap( nullptr, static_cast<size_t>(file_status.st_size), PROT_READ, MAP_PRIVATE, FileDescriptor, 0 );
+   if (data == MAP_FAILED) {
+      close();
+      return false;
+   }
+   // The whole file is about to be decoded front to back.
+   madvise( data, static_cast<size_t>(file_status.st_size), MADV_SEQUENTIAL );
+   madvise( data, static_cast<size_t>(file_status.st_size), MADV_WILLNEED );
+   Data = static_cast<const uint8_t*>(data);
+   Size = static_cast<size_t>(file_status.st_size);
+   return true;
+}
+
+void MappedFile::close()
+{
+   if (Data != nullptr) munmap( const_cast<uint8_t*>(Data), Size );
+   if (FileDescriptor >= 0) ::close( FileDescriptor );
+   Data = nullptr;
+   Size = 0;
+   FileDescriptor = -1;
+}
+#endif
@@ -0,0 +1,503 @@
+#include "MeshFile.h"
+
+#include <charconv>
+
+namespace
+{
+   const char* skipSpaces(const char* p, const char* end)
+   {
+      while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) ++p;
+      return p;
+   }
+
+   const char* skipLine(const char* p, const char* end)
+   {
+      const auto* line_end = static_cast<const char*>(std::memchr( p, '\n', static_cast<size_t>(end - p) ));
+      return line_end == nullptr ? end : line_end + 1;
+   }
+
+   template<typename T>
+   bool parseNumber(const char*& p, const char* end, T& value)
+   {
+      p = skipSpaces( p, end );
+      if (p < end && *p == '+') ++p;
+      const auto result = std::from_chars( p, end, value );
+      if (result.ec != std::errc()) return false;
+      p = result.ptr;
+      return true;
+   }
+
+   // Vertices of an OBJ face refer to a position, a texture coordinate and a normal separately,
+   // so a vertex is shared only if all three are the same.
+   struct ObjVertex
+   {
+      int Position;
+      int Texture;
+      int Normal;
+
+      bool operator==(const ObjVertex& other) const
+      {
+         return Position == other.Position && Texture == other.Texture && Normal == other.Normal;
+      }
+   };
+
+   struct ObjVertexHash
+   {
+      size_t operator()(const ObjVertex& vertex) const
+      {
+         size_t hash = std::hash<int>()(vertex.Position);
+         hash = hash * 31 + std::hash<int>()(vertex.Texture);
+         return hash * 31 + std::hash<int>()(vertex.Normal);
+      }
+   };
+
+   enum class PlyType { INT8, UINT8, INT16, UINT16, INT32, UINT32, FLOAT32, FLOAT64, UNKNOWN };
+
+   PlyType getPlyType(const std::string& name)
+   {
+      if (name == "char" || name == "int8") return PlyType::INT8;
+      if (name == "uchar" || name == "uint8") return PlyType::UINT8;
+      if (name == "short" || name == "int16") return PlyType::INT16;
+      if (name == "ushort" || name == "uint16") return PlyType::UINT16;
+      if (name == "int" || name == "int32") return PlyType::INT32;
+      if (name == "uint" || name == "uint32") return PlyType::UINT32;
+      if (name == "float" || name == "float32") return PlyType::FLOAT32;
+      if (name == "double" || name == "float64") return PlyType::FLOAT64;
+      return PlyType::UNKNOWN;
+   }
+
+   struct PlyProperty
+   {
+      std::string Name;
+      PlyType Type;
+      PlyType CountType; // UNKNOWN if the property is not a list
+   };
+
+   struct PlyElement
+   {
+      std::string Name;
+      size_t Count;
+      std::vector<PlyProperty> Properties;
+   };
+
+   // Reads the values of the body one by one, whether they are written as text or in binary.
+   class PlyReader final
+   {
+   public:
+      PlyReader(const char* data, const char* end, bool is_ascii, bool is_big_endian) :
+         Data( data ), End( end ), IsASCII( is_ascii ), IsBigEndian( is_big_endian ) {}
+
+      [[nodiscard]] bool read(PlyType type, double& value)
+      {
+         if (IsASCII) {
+            while (Data < End && std::isspace( static_cast<unsigned char>(*Data) )) ++Data;
+            return parseNumber( Data, End, value );
+         }
+
+         switch (type) {
+            case PlyType::INT8: return readBinary<int8_t>( value );
+            case PlyType::UINT8: return readBinary<uint8_t>( value );
+            case PlyType::INT16: return readBinary<int16_t>( value );
+            case PlyType::UINT16: return readBinary<uint16_t>( value );
+            case PlyType::INT32: return readBinary<int32_t>( value );
+            case PlyType::UINT32: return readBinary<uint32_t>( value );
+            case PlyType::FLOAT32: return readBinary<float>( value );
+            case PlyType::FLOAT64: return readBinary<double>( value );
+            default: return false;
+         }
+      }
+
+   private:
+      const char* Data;
+      const char* End;
+      bool IsASCII;
+      bool IsBigEndian;
+
+      template<typename T>
+      [[nodiscard]] bool readBinary(double& value)
+      {
+         if (End - Data < static_cast<std::ptrdiff_t>(sizeof( T ))) return false;
+
+         std::array<char, sizeof( T )> bytes{};
+         std::memcpy( bytes.data(), Data, sizeof( T ) );
+         if (IsBigEndian) std::reverse( bytes.begin(), bytes.end() );
+         T typed_value;
+         std::memcpy( &typed_value, bytes.data(), sizeof( T ) );
+         value = static_cast<double>(typed_value);
+         Data += sizeof( T );
+         return true;
+      }
+   };
+}
+
+MeshFile::MeshFile() : Header( nullptr )
+{
+}
+
+bool MeshFile::getSourceIdentity(const std::string& mesh_file_path, uint64_t& size, int64_t& time)
+{
+   std::error_code error;
+   size = static_cast<uint64_t>(std::filesystem::file_size( mesh_file_path, error ));
+   if (error) return false;
+   time = static_cast<int64_t>(std::filesystem::last_write_time( mesh_file_path, error ).time_since_epoch().count());
+   return !error;
+}
+
+bool MeshFile::parse(
+   const std::string& mesh_file_path,
+   std::vector<glm::vec3>& vertices,
+   std::vector<glm::vec3>& normals,
+   std::vector<glm::vec2>& textures,
+   std::vector<uint32_t>& indices
+)
+{
+   MappedFile file;
+   if (!file.open( mesh_file_path )) return false;
+
+   vertices.clear();
+   normals.clear();
+   textures.clear();
+   indices.clear();
+   const auto* data = reinterpret_cast<const char*>(file.getData());
+   const char* end = data + file.getSize();
+   std::string extension = std::filesystem::path(mesh_file_path).extension().string();
+   std::transform(
+      extension.begin(), extension.end(), extension.begin(),
+      [](unsigned char c) { return static_cast<char>(std::tolower( c )); }
+   );
+   bool is_parsed = false;
+   if (extension == ".obj") is_parsed = parseOBJ( data, end, vertices, normals, textures, indices );
+   else if (extension == ".ply") is_parsed = parsePLY( data, end, vertices, normals, textures, indices );
+   if (!is_parsed || vertices.empty() || indices.empty()) return false;
+
+   if (normals.empty()) computeNormals( vertices, indices, normals );
+   if (textures.empty()) textures.resize( vertices.size(), glm::vec2(0.0f) );
+   return true;
+}
+
+bool MeshFile::parseOBJ(
+   const char* data,
+   const char* end,
+   std::vector<glm::vec3>& vertices,
+   std::vector<glm::vec3>& normals,
+   std::vector<glm::vec2>& textures,
+   std::vector<uint32_t>& indices
+)
+{
+   std::vector<glm::vec3> positions, obj_normals;
+   std::vector<glm::vec2> obj_textures;
+   std::unordered_map<ObjVertex, uint32_t, ObjVertexHash> vertex_indices;
+   std::vector<uint32_t> polygon;
+   bool has_all_normals = true;
+   bool has_all_textures = true;
+
+   // OBJ indices start from 1, and negative ones count back from the last element read so far.
+   const auto resolve = [](int index, size_t size) { return index > 0 ? index - 1 : static_cast<int>(size) + index; };
+   for (const char* p = data; p < end; p = skipLine( p, end )) {
+      p = skipSpaces( p, end );
+      if (end - p < 2) continue;
+
+      if (p[0] == 'v' && p[1] == ' ') {
+         glm::vec3 position;
+         ++p;
+         if (!parseNumber( p, end, position.x ) || !parseNumber( p, end, position.y ) ||
+             !parseNumber( p, end, position.z )) return false;
+         positions.emplace_back( position );
+      }
+      else if (p[0] == 'v' && p[1] == 't') {
+         glm::vec2 texture;
+         p += 2;
+         if (!parseNumber( p, end, texture.x )) return false;
+         if (!parseNumber( p, end, texture.y )) texture.y = 0.0f;
+         obj_textures.emplace_back( texture );
+      }
+      else if (p[0] == 'v' && p[1] == 'n') {
+         glm::vec3 normal;
+         p += 2;
+         if (!parseNumber( p, end, normal.x ) || !parseNumber( p, end, normal.y ) ||
+             !parseNumber( p, end, normal.z )) return false;
+         obj_normals.emplace_back( normal );
+      }
+      else if (p[0] == 'f' && p[1] == ' ') {
+         polygon.clear();
+         ++p;
+         int position_index;
+         while (parseNumber( p, end, position_index )) {
+            ObjVertex vertex{ resolve( position_index, positions.size() ), -1, -1 };
+            if (p < end && *p == '/') {
+               ++p;
+               int index;
+               if (p < end && *p != '/' && parseNumber( p, end, index )) vertex.Texture = resolve( index, obj_textures.size() );
+               if (p < end && *p == '/') {
+                  ++p;
+                  if (parseNumber( p, end, index )) vertex.Normal = resolve( index, obj_normals.size() );
+               }
+            }
+            if (vertex.Position < 0 || vertex.Position >= static_cast<int>(positions.size()) ||
+                vertex.Texture >= static_cast<int>(obj_textures.size()) ||
+                vertex.Normal >= static_cast<int>(obj_normals.size())) return false;
+
+            const auto it = vertex_indices.try_emplace( vertex, static_cast<uint32_t>(vertices.size()) );
+            if (it.second) {
+               vertices.emplace_back( positions[vertex.Position] );
+               normals.emplace_back( vertex.Normal < 0 ? glm::vec3(0.0f) : obj_normals[vertex.Normal] );
+               textures.emplace_back( vertex.Texture < 0 ? glm::vec2(0.0f) : obj_textures[vertex.Texture] );
+               has_all_normals = has_all_normals && vertex.Normal >= 0;
+               has_all_textures = has_all_textures && vertex.Texture >= 0;
+            }
+            polygon.emplace_back( it.first->second );
+         }
+         for (size_t i = 2; i < polygon.size(); ++i) {
+            indices.insert( indices.end(), { polygon[0], polygon[i - 1], polygon[i] } );
+         }
+      }
+   }
+   if (!has_all_normals) normals.clear();
+   if (!has_all_textures) textures.clear();
+   return true;
+}
+
+bool MeshFile::parsePLY(
+   const char* data,
+   const char* end,
+   std::vector<glm::vec3>& vertices,
+   std::vector<glm::vec3>& normals,
+   std::vector<glm::vec2>& textures,
+   std::vector<uint32_t>& indices
+)
+{
+   const char* p = data;
+   if (end - p < 3 || std::strncmp( p, "ply", 3 ) != 0) return false;
+
+   bool is_ascii = false;
+   bool is_big_endian = false;
+   bool has_format = false;
+   std::vector<PlyElement> elements;
+   for (p = skipLine( p, end ); p < end;) {
+      const char* line_end = skipLine( p, end );
+      std::istringstream line(std::string(p, line_end));
+      p = line_end;
+
+      std::string keyword;
+      line >> keyword;
+      if (keyword == "end_header") break;
+      if (keyword == "format") {
+         std::string format;
+         line >> format;
+         is_ascii = format == "ascii";
+         is_big_endian = format == "binary_big_endian";
+         has_format = is_ascii || is_big_endian || format == "binary_little_endian";
+      }
+      else if (keyword == "element") {
+         PlyElement element;
+         line >> element.Name >> element.Count;
+         elements.emplace_back( element );
+      }
+      else if (keyword == "property" && !elements.empty()) {
+         PlyProperty property;
+         std::string type;
+         line >> type;
+         if (type == "list") {
+            std::string count_type, item_type;
+            line >> count_type >> item_type >> property.Name;
+            property.CountType = getPlyType( count_type );
+            property.Type = getPlyType( item_type );
+            if (property.CountType == PlyType::UNKNOWN) return false;
+         }
+         else {
+            line >> property.Name;
+            property.Type = getPlyType( type );
+            property.CountType = PlyType::UNKNOWN;
+         }
+         if (property.Type == PlyType::UNKNOWN) return false;
+         elements.back().Properties.emplace_back( property );
+      }
+   }
+   if (!has_format) return false;
+
+   PlyReader reader(p, end, is_ascii, is_big_endian);
+   std::vector<uint32_t> polygon;
+   bool has_normals = false;
+   bool has_textures = false;
+   for (const auto& element : elements) {
+      const bool is_vertex = element.Name == "vertex";
+      const bool is_face = element.Name == "face";
+      if (is_vertex) {
+         vertices.resize( element.Count, glm::vec3(0.0f) );
+         normals.resize( element.Count, glm::vec3(0.0f) );
+         textures.resize( element.Count, glm::vec2(0.0f) );
+         for (const auto& property : element.Properties) {
+            has_normals = has_normals || property.Name == "nx";
+            has_textures = has_textures || property.Name == "u" || property.Name == "s" || property.Name == "texture_u";
+         }
+      }
+      for (size_t i = 0; i < element.Count; ++i) {
+         for (const auto& property : element.Properties) {
+            double value;
+            if (property.CountType == PlyType::UNKNOWN) {
+               if (!reader.read( property.Type, value )) return false;
+               if (!is_vertex) continue;
+
+               const auto v = static_cast<float>(value);
+               const std::string& name = property.Name;
+               if (name == "x") vertices[i].x = v;
+               else if (name == "y") vertices[i].y = v;
+               else if (name == "z") vertices[i].z = v;
+               else if (name == "nx") normals[i].x = v;
+               else if (name == "ny") normals[i].y = v;
+               else if (name == "nz") normals[i].z = v;
+               else if (name == "u" || name == "s" || name == "texture_u") textures[i].x = v;
+               else if (name == "v" || name == "t" || name == "texture_v") textures[i].y = v;
+               continue;
+            }
+
+            double count;
+            if (!reader.read( property.CountType, count ) || count < 0.0) return false;
+            const bool is_face_indices =
+               is_face && (property.Name == "vertex_indices" || property.Name == "vertex_index");
+            polygon.clear();
+            for (auto n = static_cast<size_t>(count); n > 0; --n) {
+               if (!reader.read( property.Type, value )) return false;
+               if (!is_face_indices) continue;
+               if (value < 0.0 || value >= static_cast<double>(vertices.size())) return false;
+               polygon.emplace_back( static_cast<uint32_t>(value) );
+            }
+            for (size_t k = 2; k < polygon.size(); ++k) {
+               indices.insert( indices.end(), { polygon[0], polygon[k - 1], polygon[k] } );
+            }
+         }
+      }
+   }
+   if (!has_normals) normals.clear();
+   if (!has_textures) textures.clear();
+   return true;
+}
+
+void MeshFile::computeNormals(
+   const std::vector<glm::vec3>& vertices,
+   const std::vector<uint32_t>& indices,
+   std::vector<glm::vec3>& normals
+)
+{
+   normals.assign( vertices.size(), glm::vec3(0.0f) );
+   for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+      const glm::vec3& a = vertices[indices[i]];
+      const glm::vec3 face_normal = glm::cross( vertices[indices[i + 1]] - a, vertices[indices[i + 2]] - a );
+      normals[indices[i]] += face_normal;
+      normals[indices[i + 1]] += face_normal;
+      normals[indices[i + 2]] += face_normal;
+   }
+   for (auto& normal : normals) {
+      const float length = glm::length( normal );
+      normal = length > 0.0f ? normal / length : glm::vec3(0.0f, 0.0f, 1.0f);
+   }
+}
+
+bool MeshFile::writeCache(
+   const std::string& mesh_file_path,
+   const void* vertices,
+   size_t vertex_num,
+   size_t vertex_stride,
+   const std::vector<uint32_t>& indices,
+   const std::vector<BoundingVolumeHierarchy::Node>& nodes
+)
+{
+   CacheHeader header{};
+   std::memcpy( header.Magic, CacheMagic, sizeof( CacheMagic ) );
+   header.Version = CacheVersion;
+   header.VertexStride = static_cast<uint32_t>(vertex_stride);
+   if (!getSourceIdentity( mesh_file_path, header.SourceSize, header.SourceTime )) return false;
+
+   // The indices are stored in the type which ObjectGL::setIndices() would choose for them.
+   const auto align = [](uint64_t offset) { return (offset + CachePageSize - 1) / CachePageSize * CachePageSize; };
+   const bool is_short = vertex_num <= std::numeric_limits<uint16_t>::max() + size_t{ 1 };
+   const uint64_t vertex_bytes = static_cast<uint64_t>(vertex_num) * vertex_stride;
+   header.VertexNum = vertex_num;
+   header.VertexOffset = CachePageSize;
+   header.IndexNum = indices.size();
+   header.IndexOffset = align( header.VertexOffset + vertex_bytes );
+   header.IndexType = is_short ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+   const uint64_t index_bytes = indices.size() * (is_short ? sizeof( uint16_t ) : sizeof( uint32_t ));
+   header.NodeNum = nodes.size();
+   header.NodeOffset = align( header.IndexOffset + index_bytes );
+
+   // The cache is written aside and renamed, so a run which stops halfway never leaves a truncated cache behind.
+   const std::string cache_path = getCachePath( mesh_file_path );
+   const std::string temporary_path = cache_path + ".tmp";
+   {
+      std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+      if (!file.is_open()) return false;
+
+      const std::vector<char> padding(CachePageSize, 0);
+      const auto pad_to = [&file, &padding](uint64_t offset)
+      {
+         const auto position = static_cast<uint64_t>(file.tellp());
+         if (offset > position) file.write( padding.data(), static_cast<std::streamsize>(offset - position) );
+      };
+      file.write( reinterpret_cast<const char*>(&header), sizeof( header ) );
+      pad_to( header.VertexOffset );
+      file.write( static_cast<const char*>(vertices), static_cast<std::streamsize>(vertex_bytes) );
+      pad_to( header.IndexOffset );
+      if (is_short) {
+         const std::vector<uint16_t> short_indices(indices.begin(), indices.end());
+         file.write(
+            reinterpret_cast<const char*>(short_indices.data()),
+            static_cast<std::streamsize>(sizeof( uint16_t ) * short_indices.size())
+         );
+      }
+      else {
+         file.write(
+            reinterpret_cast<const char*>(indices.data()),
+            static_cast<std::streamsize>(sizeof( uint32_t ) * indices.size())
+         );
+      }
+      pad_to( header.NodeOffset );
+      file.write(
+         reinterpret_cast<const char*>(nodes.data()),
+         static_cast<std::streamsize>(sizeof( BoundingVolumeHierarchy::Node ) * nodes.size())
+      );
+      if (!file.good()) {
+         file.close();
+         std::filesystem::remove( temporary_path );
+         return false;
+      }
+   }
+
+   std::error_code error;
+   std::filesystem::rename( temporary_path, cache_path, error );
+   if (error) std::filesystem::remove( temporary_path, error );
+   return !error;
+}
+
+bool MeshFile::openCache(const std::string& mesh_file_path, size_t vertex_stride)
+{
+   closeCache();
+
+   uint64_t source_size;
+   int64_t source_time;
+   if (!getSourceIdentity( mesh_file_path, source_size, source_time )) return false;
+   if (!Cache.open( getCachePath( mesh_file_path ) ) || Cache.getSize() < sizeof( CacheHeader )) return false;
+
+   const auto* header = reinterpret_cast<const CacheHeader*>(Cache.getData());
+   const size_t index_size = header->IndexType == GL_UNSIGNED_SHORT ? sizeof( uint16_t ) : sizeof( uint32_t );
+   const bool is_valid = std::memcmp( header->Magic, CacheMagic, sizeof( CacheMagic ) ) == 0 &&
+      header->Version == CacheVersion && header->VertexStride == vertex_stride &&
+      header->SourceSize == source_size && header->SourceTime == source_time &&
+      (header->IndexType == GL_UNSIGNED_SHORT || header->IndexType == GL_UNSIGNED_INT) &&
+      header->VertexNum > 0 && header->IndexNum > 0 &&
+      header->VertexOffset + header->VertexNum * vertex_stride <= header->IndexOffset &&
+      header->IndexOffset + header->IndexNum * index_size <= header->NodeOffset &&
+      header->NodeOffset + header->NodeNum * sizeof( BoundingVolumeHierarchy::Node ) <= Cache.getSize();
+   if (!is_valid) {
+      Cache.close();
+      return false;
+   }
+   Header = header;
+   return true;
+}
+
+void MeshFile::closeCache()
+{
+   Cache.close();
+   Header = nullptr;
+}
@@ -1,9 +1,11 @@
 #include "Object.h"
+#include "VertexCache.h"
 
 #include "opencv2/core/matx.hpp"
 
 ObjectGL::ObjectGL() :
-   ImageBuffer( nullptr ), VAO( 0 ), VBO( 0 ), DrawMode( 0 ), VerticesCount( 0 ),
+   ImageBuffer( nullptr ), VAO( 0 ), VBO( 0 ), EBO( 0 ), DrawMode( 0 ), IndexType( GL_UNSIGNED_INT ),
+   IndicesCount( 0 ), UploadedByteNum( 0 ), VerticesCount( 0 ), VertexStride( 0 ),
    EmissionColor( 0.0f, 0.0f, 0.0f, 1.0f ),
    AmbientReflectionColor( 0.2f, 0.2f, 0.2f, 1.0f ),
    DiffuseReflectionColor( 0.8f, 0.8f, 0.8f, 1.0f ),
@@ -17,12 +19,14 @@ ObjectGL::~ObjectGL()
       glDeleteVertexArrays( 1, &VAO );
       glDeleteBuffers( 1, &VBO );
    }
+   if (EBO != 0) glDeleteBuffers( 1, &EBO );
    for (const auto& texture_id : TextureID) {
       if (texture_id != 0) glDeleteTextures( 1, &texture_id );
    }
    for (const auto& buffer : CustomBuffers) {
       if (buffer.second != 0) glDeleteBuffers( 1, &buffer.second );
    }
+   while (!StreamingBuffers.empty()) releaseStreamingTexture( StreamingBuffers.begin()->first );
    delete [] ImageBuffer;
 }
 
@@ -78,17 +82,54 @@ bool ObjectGL::prepareTexture2DUsingFreeImage(const std::string& file_path, bool
    return true;
 }
 
-void ObjectGL::prepareTexture2DFromMat(const cv::Mat& texture) const
+void ObjectGL::uploadTexture2DFromMat(GLuint texture_id, const cv::Mat& texture)
+{
+   // NOTE: 'texture' is uploaded as it is, so the first row of the Mat becomes the bottom row of the texture.
+   // The vertical flip is handled in the texture coordinates instead of copying the whole image every frame.
+   GLenum internal_format, format;
+   getTextureFormat( texture, internal_format, format );
+   const auto element_size = static_cast<GLint>(texture.elemSize());
+   glPixelStorei( GL_UNPACK_ALIGNMENT, texture.step[0] % 4 == 0 ? 4 : 1 );
+   glPixelStorei( GL_UNPACK_ROW_LENGTH, static_cast<GLint>(texture.step[0]) / element_size );
+   glTextureSubImage2D( texture_id, 0, 0, 0, texture.cols, texture.rows, format, GL_UNSIGNED_BYTE, texture.data );
+   glPixelStorei( GL_UNPACK_ROW_LENGTH, 0 );
+   glPixelStorei( GL_UNPACK_ALIGNMENT, 4 );
+}
+
+void ObjectGL::prepareTexture2DFromMat(GLuint texture_id, const cv::Mat& texture)
 {
-   // NOTE: 'texture' is going to be flipped vertically.
-   // OpenGL texture's origin is bottom-left, but OpenCV Mat's is top-left.
-   const int width = texture.cols;
-   const int height = texture.rows;
+   // The texture keeps the channel layout of the source, so the driver does not need to convert it on upload.
+   // BGR is stored as RGB8 and swapped back by the texture swizzle when it is sampled.
+   GLenum internal_format, format;
+   getTextureFormat( texture, internal_format, format );
+   glTextureStorage2D( texture_id, 1, internal_format, texture.cols, texture.rows );
+   if (texture.channels() == 3) {
+      const std::array<GLint, 4> swizzle = { GL_BLUE, GL_GREEN, GL_RED, GL_ONE };
+      glTextureParameteriv( texture_id, GL_TEXTURE_SWIZZLE_RGBA, swizzle.data() );
+   }
+   else if (texture.channels() == 1) {
+      const std::array<GLint, 4> swizzle = { GL_RED, GL_RED, GL_RED, GL_ONE };
+      glTextureParameteriv( texture_id, GL_TEXTURE_SWIZZLE_RGBA, swizzle.data() );
+   }
+   uploadTexture2DFromMat( texture_id, texture );
+}
 
-   cv::Mat flipped;
-   cv::flip( texture, flipped, 0 );
-   glTextureStorage2D( TextureID.back(), 1, GL_RGBA8, width, height );
-   glTextureSubImage2D( TextureID.back(), 0, 0, 0, width, height, GL_BGR, GL_UNSIGNED_BYTE, flipped.data );
+void ObjectGL::getTextureFormat(const cv::Mat& texture, GLenum& internal_format, GLenum& format)
+{
+   switch (texture.channels()) {
+      case 1:
+         internal_format = GL_R8;
+         format = GL_RED;
+         break;
+      case 4:
+         internal_format = GL_RGBA8;
+         format = GL_BGRA;
+         break;
+      default:
+         internal_format = GL_RGB8;
+         format = GL_RGB;
+         break;
+   }
 }
 
 int ObjectGL::addTexture(const std::string& texture_file_path, bool is_grayscale)
@@ -116,13 +157,12 @@ int ObjectGL::addTexture(const cv::Mat& texture)
    GLuint texture_id = 0;
    glCreateTextures( GL_TEXTURE_2D, 1, &texture_id );
    TextureID.emplace_back( texture_id );
-   prepareTexture2DFromMat( texture );
+   prepareTexture2DFromMat( texture_id, texture );
 
-   glTextureParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
-   glTextureParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
-   glTextureParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT );
-   glTextureParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT );
-   glGenerateTextureMipmap( texture_id );
+   glTextureParameteri( texture_id, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+   glTextureParameteri( texture_id, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+   glTextureParameteri( texture_id, GL_TEXTURE_WRAP_S, GL_REPEAT );
+   glTextureParameteri( texture_id, GL_TEXTURE_WRAP_T, GL_REPEAT );
    return static_cast<int>(TextureID.size() - 1);
 }
 
@@ -162,31 +202,27 @@ int ObjectGL::addTexture(const uint8_t* image_buffer, int width, int height, boo
    return static_cast<int>(TextureID.size() - 1);
 }
 
-void ObjectGL::prepareTexture(bool normals_exist) const
+void ObjectGL::prepareVertexBuffer(GLsizei stride, const void* data)
 {
-   const uint offset = normals_exist ? 6 : 3;
-   glVertexArrayAttribFormat( VAO, TextureLoc, 2, GL_FLOAT, GL_FALSE, offset * sizeof( GLfloat ) );
-   glEnableVertexArrayAttrib( VAO, TextureLoc );
-   glVertexArrayAttribBinding( VAO, TextureLoc, 0 );
-}
-
-void ObjectGL::prepareNormal() const
-{
-   glVertexArrayAttribFormat( VAO, NormalLoc, 3, GL_FLOAT, GL_FALSE, 3 * sizeof( GLfloat ) );
-   glEnableVertexArrayAttrib( VAO, NormalLoc );
-   glVertexArrayAttribBinding( VAO, NormalLoc, 0 );
-}
+   if (VAO != 0) {
+      glDeleteVertexArrays( 1, &VAO );
+      glDeleteBuffers( 1, &VBO );
+   }
+   if (EBO != 0) {
+      glDeleteBuffers( 1, &EBO );
+      EBO = 0;
+      IndicesCount = 0;
+   }
+   BVH.reset();
 
-void ObjectGL::prepareVertexBuffer(int n_bytes_per_vertex)
-{
+   VertexStride = stride;
    glCreateBuffers( 1, &VBO );
-   glNamedBufferStorage( VBO, sizeof( GLfloat ) * DataBuffer.size(), DataBuffer.data(), GL_DYNAMIC_STORAGE_BIT );
+   glNamedBufferStorage(
+      VBO, static_cast<GLsizeiptr>(stride) * VerticesCount, data, GL_DYNAMIC_STORAGE_BIT
+   );
 
    glCreateVertexArrays( 1, &VAO );
-   glVertexArrayVertexBuffer( VAO, 0, VBO, 0, n_bytes_per_vertex );
-   glVertexArrayAttribFormat( VAO, VertexLoc, 3, GL_FLOAT, GL_FALSE, 0 );
-   glEnableVertexArrayAttrib( VAO, VertexLoc );
-   glVertexArrayAttribBinding( VAO, VertexLoc, 0 );
+   glVertexArrayVertexBuffer( VAO, 0, VBO, 0, stride );
 }
 
 void ObjectGL::getSquareObject(
@@ -226,17 +262,7 @@ void ObjectGL::getSquareObject(
 
 void ObjectGL::setObject(GLenum draw_mode, const std::vector<glm::vec3>& vertices)
 {
-   DrawMode = draw_mode;
-   VerticesCount = 0;
-   DataBuffer.clear();
-   for (const auto& vertex : vertices) {
-      DataBuffer.push_back( vertex.x );
-      DataBuffer.push_back( vertex.y );
-      DataBuffer.push_back( vertex.z );
-      VerticesCount++;
-   }
-   const int n_bytes_per_vertex = 3 * sizeof( GLfloat );
-   prepareVertexBuffer( n_bytes_per_vertex );
+   setVertices<PositionFormat>( draw_mode, vertices );
 }
 
 void ObjectGL::setObject(
@@ -245,21 +271,16 @@ void ObjectGL::setObject(
    const std::vector<glm::vec3>& normals
 )
 {
-   DrawMode = draw_mode;
-   VerticesCount = 0;
-   DataBuffer.clear();
-   for (size_t i = 0; i < vertices.size(); ++i) {
-      DataBuffer.push_back( vertices[i].x );
-      DataBuffer.push_back( vertices[i].y );
-      DataBuffer.push_back( vertices[i].z );
-      DataBuffer.push_back( normals[i].x );
-      DataBuffer.push_back( normals[i].y );
-      DataBuffer.push_back( normals[i].z );
-      VerticesCount++;
-   }
-   const int n_bytes_per_vertex = 6 * sizeof( GLfloat );
-   prepareVertexBuffer( n_bytes_per_vertex );
-   prepareNormal();
+   setVertices<PositionNormalFormat>( draw_mode, vertices, normals );
+}
+
+void ObjectGL::setObject(
+   GLenum draw_mode,
+   const std::vector<glm::vec3>& vertices,
+   const std::vector<glm::vec2>& textures
+)
+{
+   setVertices<PositionTextureFormat>( draw_mode, vertices, textures );
 }
 
 void ObjectGL::setObject(
@@ -270,20 +291,7 @@ void ObjectGL::setObject(
    bool is_grayscale
 )
 {
-   DrawMode = draw_mode;
-   VerticesCount = 0;
-   DataBuffer.clear();
-   for (size_t i = 0; i < vertices.size(); ++i) {
-      DataBuffer.push_back( vertices[i].x );
-      DataBuffer.push_back( vertices[i].y );
-      DataBuffer.push_back( vertices[i].z );
-      DataBuffer.push_back( textures[i].x );
-      DataBuffer.push_back( textures[i].y );
-      VerticesCount++;
-   }
-   const int n_bytes_per_vertex = 5 * sizeof( GLfloat );
-   prepareVertexBuffer( n_bytes_per_vertex );
-   prepareTexture( false );
+   setVertices<PositionTextureFormat>( draw_mode, vertices, textures );
    addTexture( texture_file_path, is_grayscale );
 }
 
@@ -294,24 +302,7 @@ void ObjectGL::setObject(
    const std::vector<glm::vec2>& textures
 )
 {
-   DrawMode = draw_mode;
-   VerticesCount = 0;
-   DataBuffer.clear();
-   for (size_t i = 0; i < vertices.size(); ++i) {
-      DataBuffer.push_back( vertices[i].x );
-      DataBuffer.push_back( vertices[i].y );
-      DataBuffer.push_back( vertices[i].z );
-      DataBuffer.push_back( normals[i].x );
-      DataBuffer.push_back( normals[i].y );
-      DataBuffer.push_back( normals[i].z );
-      DataBuffer.push_back( textures[i].x );
-      DataBuffer.push_back( textures[i].y );
-      VerticesCount++;
-   }
-   const int n_bytes_per_vertex = 8 * sizeof( GLfloat );
-   prepareVertexBuffer( n_bytes_per_vertex );
-   prepareNormal();
-   prepareTexture( true );
+   setVertices<PositionNormalTextureFormat>( draw_mode, vertices, normals, textures );
 }
 
 void ObjectGL::setObject(
@@ -323,32 +314,113 @@ void ObjectGL::setObject(
    bool is_grayscale
 )
 {
-   setObject( draw_mode, vertices, normals, textures );
+   setVertices<PositionNormalTextureFormat>( draw_mode, vertices, normals, textures );
    addTexture( texture_file_path, is_grayscale );
 }
 
 void ObjectGL::setObject(
-   GLenum draw_mode, 
-   const std::vector<glm::vec3>& vertices, 
+   GLenum draw_mode,
+   const std::vector<glm::vec3>& vertices,
    const std::vector<glm::vec2>& textures,
    const cv::Mat& texture
 )
 {
-   DrawMode = draw_mode;
-   for (uint i = 0; i < vertices.size(); ++i) {
-      DataBuffer.push_back( vertices[i].x );
-      DataBuffer.push_back( vertices[i].y );
-      DataBuffer.push_back( vertices[i].z );
-      DataBuffer.push_back( textures[i].x );
-      DataBuffer.push_back( textures[i].y );
-      VerticesCount++;
-   }
-   const int n_bytes_per_vertex = 5 * sizeof(GLfloat);
-   prepareVertexBuffer( n_bytes_per_vertex );
-   prepareTexture( false );
+   setVertices<PositionTextureFormat>( draw_mode, vertices, textures );
    addTexture( texture );
 }
 
+void ObjectGL::reorderVerticesByFirstUse(std::vector<uint32_t>& indices)
+{
+   // Vertices which no index refers to keep their relative order after the used ones.
+   const auto vertex_num = static_cast<size_t>(VerticesCount);
+   const auto stride = static_cast<size_t>(VertexStride);
+   constexpr uint32_t unassigned = std::numeric_limits<uint32_t>::max();
+   std::vector<uint32_t> remap(vertex_num, unassigned);
+   uint32_t next_vertex = 0;
+   for (uint32_t& index : indices) {
+      if (remap[index] == unassigned) remap[index] = next_vertex++;
+      index = remap[index];
+   }
+   for (auto& vertex : remap) {
+      if (vertex == unassigned) vertex = next_vertex++;
+   }
+
+   std::vector<uint8_t> reordered(DataBuffer.size());
+   for (size_t v = 0; v < vertex_num; ++v) {
+      std::copy_n( DataBuffer.begin() + v * stride, stride, reordered.begin() + remap[v] * stride );
+   }
+   DataBuffer.swap( reordered );
+   glNamedBufferSubData( VBO, 0, static_cast<GLsizeiptr>(DataBuffer.size()), DataBuffer.data() );
+}
+
+void ObjectGL::setIndices(std::vector<uint32_t> indices, bool optimize_vertex_order)
+{
+   assert( VAO != 0 );
+
+   const auto vertex_num = static_cast<size_t>(VerticesCount);
+   if (std::any_of( indices.begin(), indices.end(), [vertex_num](uint32_t index) { return index >= vertex_num; } )) {
+      std::cout << "Cannot Set Indices Beyond the Vertices of the Object...\n";
+      return;
+   }
+   if (optimize_vertex_order && DrawMode == GL_TRIANGLES) {
+      indices = VertexCache::optimize( indices, vertex_num );
+      if (!DataBuffer.empty()) reorderVerticesByFirstUse( indices );
+   }
+
+   if (vertex_num <= std::numeric_limits<uint16_t>::max() + size_t{ 1 }) {
+      const std::vector<uint16_t> short_indices(indices.begin(), indices.end());
+      setIndices( short_indices.data(), short_indices.size(), GL_UNSIGNED_SHORT );
+   }
+   else setIndices( indices.data(), indices.size(), GL_UNSIGNED_INT );
+}
+
+void ObjectGL::setIndices(const void* indices, size_t index_num, GLenum index_type)
+{
+   assert( VAO != 0 );
+
+   const size_t index_size = index_type == GL_UNSIGNED_SHORT ? sizeof( uint16_t ) : sizeof( uint32_t );
+   if (EBO != 0) glDeleteBuffers( 1, &EBO );
+   glCreateBuffers( 1, &EBO );
+   IndexType = index_type;
+   IndicesCount = static_cast<GLsizei>(index_num);
+   glNamedBufferStorage( EBO, static_cast<GLsizeiptr>(index_size * index_num), indices, 0 );
+   glVertexArrayElementBuffer( VAO, EBO );
+}
+
+bool ObjectGL::setMeshObject(const std::string& mesh_file_path)
+{
+   MeshFile mesh;
+   if (mesh.openCache( mesh_file_path, MeshFormat::Stride )) {
+      setInterleavedVertices<MeshFormat>( GL_TRIANGLES, mesh.getVertices(), mesh.getVertexNum() );
+      setIndices( mesh.getIndices(), mesh.getIndexNum(), mesh.getIndexType() );
+      BVH = std::make_unique<BoundingVolumeHierarchy>();
+      BVH->setNodes( mesh.getNodes(), mesh.getNodeNum() );
+      return true;
+   }
+
+   std::vector<glm::vec3> vertices, normals;
+   std::vector<glm::vec2> textures;
+   std::vector<uint32_t> indices;
+   if (!MeshFile::parse( mesh_file_path, vertices, normals, textures, indices )) {
+      std::cout << "Cannot Read the Mesh File '" << mesh_file_path << "'...\n";
+      return false;
+   }
+
+   setVertices<MeshFormat>( GL_TRIANGLES, vertices, normals, textures );
+   indices = VertexCache::optimize( indices, vertices.size() );
+   // The chunks keep the order of their triangles, and then the vertices are reordered by their first use,
+   // so the vertices of a chunk are close together in the buffer.
+   auto bvh = std::make_unique<BoundingVolumeHierarchy>();
+   bvh->build( vertices, indices );
+   reorderVerticesByFirstUse( indices );
+   if (!MeshFile::writeCache(
+      mesh_file_path, DataBuffer.data(), vertices.size(), VertexStride, indices, bvh->getNodes()
+   )) std::cout << "Cannot Write the Mesh Cache; the mesh will be parsed again on the next run...\n";
+   setIndices( std::move( indices ) );
+   BVH = std::move( bvh );
+   return true;
+}
+
 void ObjectGL::setSquareObject(GLenum draw_mode, bool use_texture)
 {
    std::vector<glm::vec3> square_vertices, square_normals;
@@ -370,31 +442,18 @@ void ObjectGL::setSquareObject(
    setObject( draw_mode, square_vertices, square_normals, square_textures, texture_file_path, is_grayscale );
 }
 
-void ObjectGL::transferUniformsToShader(const ShaderGL* shader)
+void ObjectGL::transferUniformsToBlock(ShaderGL::ObjectUniformBlock& block) const
 {
-   glUniform4fv( shader->getMaterialEmissionLocation(), 1, &EmissionColor[0] );
-   glUniform4fv( shader->getMaterialAmbientLocation(), 1, &AmbientReflectionColor[0] );
-   glUniform4fv( shader->getMaterialDiffuseLocation(), 1, &DiffuseReflectionColor[0] );
-   glUniform4fv( shader->getMaterialSpecularLocation(), 1, &SpecularReflectionColor[0] );
-   glUniform1f( shader->getMaterialSpecularExponentLocation(), SpecularReflectionExponent );
+   block.EmissionColor = EmissionColor;
+   block.AmbientColor = AmbientReflectionColor;
+   block.DiffuseColor = DiffuseReflectionColor;
+   block.SpecularColor = SpecularReflectionColor;
+   block.SpecularExponent = SpecularReflectionExponent;
 }
 
 void ObjectGL::updateDataBuffer(const std::vector<glm::vec3>& vertices, const std::vector<glm::vec3>& normals)
 {
-   assert( VBO != 0 );
-
-   VerticesCount = 0;
-   DataBuffer.clear();
-   for (size_t i = 0; i < vertices.size(); ++i) {
-      DataBuffer.push_back( vertices[i].x );
-      DataBuffer.push_back( vertices[i].y );
-      DataBuffer.push_back( vertices[i].z );
-      DataBuffer.push_back( normals[i].x );
-      DataBuffer.push_back( normals[i].y );
-      DataBuffer.push_back( normals[i].z );
-      VerticesCount++;
-   }
-   glNamedBufferSubData( VBO, 0, sizeof( GLfloat ) * DataBuffer.size(), DataBuffer.data() );
+   updateVertices<PositionNormalFormat>( vertices, normals );
 }
 
 void ObjectGL::updateDataBuffer(
@@ -403,109 +462,225 @@ void ObjectGL::updateDataBuffer(
    const std::vector<glm::vec2>& textures
 )
 {
-   assert( VBO != 0 );
+   updateVertices<PositionNormalTextureFormat>( vertices, normals, textures );
+}
+
+void ObjectGL::replaceVertices(const std::vector<glm::vec3>& vertices)
+{
+   assert( VBO != 0 && !DataBuffer.empty() );
+   assert( vertices.size() <= static_cast<size_t>(VerticesCount) );
 
-   VerticesCount = 0;
-   DataBuffer.clear();
+   const auto stride = static_cast<size_t>(VertexStride);
    for (size_t i = 0; i < vertices.size(); ++i) {
-      DataBuffer.push_back( vertices[i].x );
-      DataBuffer.push_back( vertices[i].y );
-      DataBuffer.push_back( vertices[i].z );
-      DataBuffer.push_back( normals[i].x );
-      DataBuffer.push_back( normals[i].y );
-      DataBuffer.push_back( normals[i].z );
-      DataBuffer.push_back( textures[i].x );
-      DataBuffer.push_back( textures[i].y );
-      VerticesCount++;
+      Float3Encoding::encode( vertices[i], DataBuffer.data() + i * stride );
    }
-   glNamedBufferSubData( VBO, 0, sizeof( GLfloat ) * DataBuffer.size(), DataBuffer.data() );
+   glNamedBufferSubData( VBO, 0, static_cast<GLsizeiptr>(stride * vertices.size()), DataBuffer.data() );
 }
 
-void ObjectGL::replaceVertices(
-   const std::vector<glm::vec3>& vertices,
-   bool normals_exist,
-   bool textures_exist
-)
+void ObjectGL::replaceVertices(const std::vector<float>& vertices)
 {
-   assert( VBO != 0 );
+   assert( VBO != 0 && !DataBuffer.empty() );
+   assert( vertices.size() / 3 <= static_cast<size_t>(VerticesCount) );
 
-   VerticesCount = 0;
-   int step = 3;
-   if (normals_exist) step += 3;
-   if (textures_exist) step += 2;
-   for (size_t i = 0; i < vertices.size(); ++i) {
-      DataBuffer[i * step] = vertices[i].x;
-      DataBuffer[i * step + 1] = vertices[i].y;
-      DataBuffer[i * step + 2] = vertices[i].z;
-      VerticesCount++;
+   const auto stride = static_cast<size_t>(VertexStride);
+   const size_t vertex_num = vertices.size() / 3;
+   for (size_t i = 0; i < vertex_num; ++i) {
+      std::memcpy( DataBuffer.data() + i * stride, &vertices[i * 3], Float3Encoding::Size );
    }
-   glNamedBufferSubData( VBO, 0, sizeof( GLfloat ) * VerticesCount * step, DataBuffer.data() );
+   glNamedBufferSubData( VBO, 0, static_cast<GLsizeiptr>(stride * vertex_num), DataBuffer.data() );
 }
 
-void ObjectGL::replaceVertices(
-   const std::vector<float>& vertices,
-   bool normals_exist,
-   bool textures_exist
-)
+bool ObjectGL::recreateTexture(int index)
 {
-   assert( VBO != 0 );
-
-   VerticesCount = 0;
-   int step = 3;
-   if (normals_exist) step += 3;
-   if (textures_exist) step += 2;
-   for (size_t i = 0, j = 0; i < vertices.size(); i += 3, ++j) {
-      DataBuffer[j * step] = vertices[i];
-      DataBuffer[j * step + 1] = vertices[i + 1];
-      DataBuffer[j * step + 2] = vertices[i + 2];
-      VerticesCount++;
-   }
-   glNamedBufferSubData( VBO, 0, sizeof( GLfloat ) * VerticesCount * step, DataBuffer.data() );
+   if (index < 0) return false;
+   if (index >= static_cast<int>(TextureID.size())) TextureID.resize( index + 1, 0 );
+   else if (TextureID[index] != 0) glDeleteTextures( 1, &TextureID[index] );
+
+   glCreateTextures( GL_TEXTURE_2D, 1, &TextureID[index] );
+   return true;
 }
 
 void ObjectGL::reallocateTexture(const cv::Mat& texture, int index)
+{
+   if (!recreateTexture( index )) return;
+
+   prepareTexture2DFromMat( TextureID[index], texture );
+   glTextureParameteri( TextureID[index], GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+   glTextureParameteri( TextureID[index], GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+   glTextureParameteri( TextureID[index], GL_TEXTURE_WRAP_S, GL_REPEAT );
+   glTextureParameteri( TextureID[index], GL_TEXTURE_WRAP_T, GL_REPEAT );
+}
+
+void ObjectGL::reallocateTexture(int width, int height, GLenum internal_format, int index)
+{
+   if (!recreateTexture( index )) return;
+
+   glTextureStorage2D( TextureID[index], 1, internal_format, width, height );
+   glTextureParameteri( TextureID[index], GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+   glTextureParameteri( TextureID[index], GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+   glTextureParameteri( TextureID[index], GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+   glTextureParameteri( TextureID[index], GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+}
+
+void ObjectGL::updateTexture(const cv::Mat& texture, int index) const
 {
    if (index < static_cast<int>(TextureID.size()) && TextureID[index] != 0) {
-      glDeleteTextures( 1, &TextureID[index] );
-      glCreateTextures( GL_TEXTURE_2D, 1, &TextureID[index] );
-
-      cv::Mat flipped;
-      cv::flip( texture, flipped, 0 );
-      glTextureStorage2D( TextureID[index], 1, GL_RGBA8, texture.cols, texture.rows );
-      glTextureSubImage2D( 
-         TextureID[index], 
-         0, 
-         0, 
-         0, 
-         texture.cols, 
-         texture.rows, 
-         GL_BGR, 
-         GL_UNSIGNED_BYTE, 
-         flipped.data 
-      );
-
-      glTextureParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
-      glTextureParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
-      glTextureParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT );
-      glTextureParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT );
+      uploadTexture2DFromMat( TextureID[index], texture );
+      UploadedByteNum += texture.step[0] * texture.rows * 2;
    }
 }
 
-void ObjectGL::updateTexture(const cv::Mat& texture, int index) const
+void ObjectGL::updateTexture(const uint8_t* image_buffer, int width, int height, GLenum format, int index) const
 {
    if (index < static_cast<int>(TextureID.size()) && TextureID[index] != 0) {
-      cv::Mat flipped;
-      cv::flip( texture, flipped, 0 );
-      glTextureSubImage2D( 
-         TextureID[index], 
-         0, 
-         0, 
-         0, 
-         texture.cols, 
-         texture.rows, 
-         GL_BGR, 
-         GL_UNSIGNED_BYTE, 
-         flipped.data 
-      );
+      glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+      glTextureSubImage2D( TextureID[index], 0, 0, 0, width, height, format, GL_UNSIGNED_BYTE, image_buffer );
+      glPixelStorei( GL_UNPACK_ALIGNMENT, 4 );
+      UploadedByteNum += static_cast<size_t>(width) * height * getBytesPerPixel( format ) * 2;
+   }
+}
+
+void ObjectGL::updateTextureWithFlip(const cv::Mat& texture, int index) const
+{
+   if (index >= static_cast<int>(TextureID.size()) || TextureID[index] == 0 || texture.type() != CV_8UC3) return;
+
+   cv::Mat flipped;
+   cv::flip( texture, flipped, 0 );
+   UploadedByteNum += texture.step[0] * texture.rows * 2;
+   updateTexture( flipped.data, flipped.cols, flipped.rows, GL_BGR, index );
+}
+
+int ObjectGL::getBytesPerPixel(GLenum format)
+{
+   switch (format) {
+      case GL_RED: return 1;
+      case GL_RG: return 2;
+      case GL_RGB:
+      case GL_BGR: return 3;
+      case GL_RGBA:
+      case GL_BGRA: return 4;
+      default: return 0;
+   }
+}
+
+void ObjectGL::releaseStreamingTexture(int index)
+{
+   const auto it = StreamingBuffers.find( index );
+   if (it == StreamingBuffers.end()) return;
+
+   for (const auto& fence : it->second.Fences) {
+      if (fence != nullptr) glDeleteSync( fence );
    }
+   if (it->second.Buffer != 0) {
+      glUnmapNamedBuffer( it->second.Buffer );
+      glDeleteBuffers( 1, &it->second.Buffer );
+   }
+   StreamingBuffers.erase( it );
+}
+
+void ObjectGL::prepareStreamingTexture(int index, int width, int height, GLenum format, int buffer_num)
+{
+   releaseStreamingTexture( index );
+
+   StreamingBuffer streaming;
+   streaming.Width = width;
+   streaming.Height = height;
+   streaming.Format = format;
+   streaming.RowSize = width * getBytesPerPixel( format );
+   streaming.SlotSize = (static_cast<GLsizeiptr>(streaming.RowSize) * height + 255) & ~static_cast<GLsizeiptr>(255);
+   streaming.Fences.resize( std::max( buffer_num, 2 ), nullptr );
+
+   const auto n_slots = static_cast<GLsizeiptr>(streaming.Fences.size());
+   constexpr GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+   glCreateBuffers( 1, &streaming.Buffer );
+   glNamedBufferStorage( streaming.Buffer, streaming.SlotSize * n_slots, nullptr, flags );
+   streaming.MappedData = static_cast<uint8_t*>(
+      glMapNamedBufferRange( streaming.Buffer, 0, streaming.SlotSize * n_slots, flags )
+   );
+   if (streaming.MappedData == nullptr) {
+      glDeleteBuffers( 1, &streaming.Buffer );
+      std::cerr << "Could not map the streaming texture buffer\n";
+      return;
+   }
+   StreamingBuffers[index] = streaming;
+}
+
+uint8_t* ObjectGL::mapStreamingTexture(int index)
+{
+   const auto it = StreamingBuffers.find( index );
+   if (it == StreamingBuffers.end()) return nullptr;
+
+   // The slot is reused only after the GPU has finished the upload which was reading it.
+   StreamingBuffer& streaming = it->second;
+   GLsync& fence = streaming.Fences[streaming.Current];
+   if (fence != nullptr) {
+      GLenum result;
+      do {
+         result = glClientWaitSync( fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000 );
+      } while (result == GL_TIMEOUT_EXPIRED);
+      glDeleteSync( fence );
+      fence = nullptr;
+   }
+   return streaming.MappedData + streaming.SlotSize * streaming.Current;
+}
+
+void ObjectGL::commitStreamingTexture(int index)
+{
+   const auto it = StreamingBuffers.find( index );
+   if (it == StreamingBuffers.end() || index >= static_cast<int>(TextureID.size()) || TextureID[index] == 0) return;
+
+   StreamingBuffer& streaming = it->second;
+   const GLintptr offset = streaming.SlotSize * streaming.Current;
+   glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+   glBindBuffer( GL_PIXEL_UNPACK_BUFFER, streaming.Buffer );
+   glTextureSubImage2D(
+      TextureID[index],
+      0,
+      0,
+      0,
+      streaming.Width,
+      streaming.Height,
+      streaming.Format,
+      GL_UNSIGNED_BYTE,
+      reinterpret_cast<const void*>(offset)
+   );
+   glBindBuffer( GL_PIXEL_UNPACK_BUFFER, 0 );
+   glPixelStorei( GL_UNPACK_ALIGNMENT, 4 );
+   streaming.Fences[streaming.Current] = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+   streaming.Current = (streaming.Current + 1) % static_cast<int>(streaming.Fences.size());
+}
+
+void ObjectGL::streamTexture(const cv::Mat& texture, int index)
+{
+   const auto it = StreamingBuffers.find( index );
+   if (it == StreamingBuffers.end() || it->second.Width != texture.cols || it->second.Height != texture.rows) {
+      updateTexture( texture, index );
+      return;
+   }
+
+   uint8_t* slot = mapStreamingTexture( index );
+   if (slot == nullptr) return;
+
+   const int row_size = it->second.RowSize;
+   if (texture.isContinuous()) std::memcpy( slot, texture.data, static_cast<size_t>(row_size) * texture.rows );
+   else {
+      for (int i = 0; i < texture.rows; ++i) {
+         std::memcpy( slot + static_cast<size_t>(i) * row_size, texture.ptr( i ), row_size );
+      }
+   }
+   UploadedByteNum += static_cast<size_t>(row_size) * texture.rows * 2;
+   commitStreamingTexture( index );
+}
+
+void ObjectGL::streamTexture(const uint8_t* image_buffer, int index)
+{
+   const auto it = StreamingBuffers.find( index );
+   if (it == StreamingBuffers.end()) return;
+
+   uint8_t* slot = mapStreamingTexture( index );
+   if (slot == nullptr) return;
+
+   std::memcpy( slot, image_buffer, static_cast<size_t>(it->second.RowSize) * it->second.Height );
+   UploadedByteNum += static_cast<size_t>(it->second.RowSize) * it->second.Height * 2;
+   commitStreamingTexture( index );
 }
\ No newline at end of file
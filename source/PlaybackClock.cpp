@@ -0,0 +1,34 @@
+#include "PlaybackClock.h"
+
+PlaybackClock::PlaybackClock() :
+   IsPaused( false ), StartTime( 0.0 ), PausedTime( 0.0 ), StartPoint( std::chrono::steady_clock::now() )
+{
+}
+
+void PlaybackClock::start(double start_time_in_ms)
+{
+   IsPaused = false;
+   StartTime = start_time_in_ms;
+   StartPoint = std::chrono::steady_clock::now();
+}
+
+void PlaybackClock::pause()
+{
+   if (IsPaused) return;
+   PausedTime = getTime();
+   IsPaused = true;
+}
+
+void PlaybackClock::resume()
+{
+   if (!IsPaused) return;
+   start( PausedTime );
+}
+
+double PlaybackClock::getTime() const
+{
+   if (IsPaused) return PausedTime;
+
+   const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - StartPoint;
+   return StartTime + elapsed.count();
+}
@@ -0,0 +1,201 @@
+#include "Profiler.h"
+
+ProfilerGL::Scope::Scope(ProfilerGL* profiler, const char* name, bool is_gpu_timed) :
+   Profiler( profiler != nullptr && profiler->isEnabled() ? profiler : nullptr ), Name( name ), Query( 0 ),
+   StartTimeInUs( 0 )
+{
+   if (Profiler == nullptr) return;
+
+   StartTimeInUs = Profiler->getTimeInUs();
+   if (is_gpu_timed) {
+      Query = Profiler->acquireQuery();
+      glBeginQuery( GL_TIME_ELAPSED, Query );
+   }
+}
+
+ProfilerGL::Scope::~Scope()
+{
+   if (Profiler == nullptr) return;
+
+   if (Query != 0) glEndQuery( GL_TIME_ELAPSED );
+   Profiler->recordEvent( Name, StartTimeInUs, Profiler->getTimeInUs(), Query );
+}
+
+ProfilerGL::ProfilerGL(int event_capacity, int query_latency) :
+   IsEnabled( false ), QueryLatency( std::max( query_latency, 1 ) ), Frame( 0 ), EventNum( 0 ),
+   Events( std::max( event_capacity, 1 ) ), BaseTime( std::chrono::steady_clock::now() )
+{
+}
+
+ProfilerGL::~ProfilerGL()
+{
+   for (const auto& pending : PendingQueries) glDeleteQueries( 1, &pending.Query );
+   if (!FreeQueries.empty()) glDeleteQueries( static_cast<GLsizei>(FreeQueries.size()), FreeQueries.data() );
+}
+
+int64_t ProfilerGL::getTimeInUs() const
+{
+   return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - BaseTime).count();
+}
+
+GLuint ProfilerGL::acquireQuery()
+{
+   GLuint query = 0;
+   if (FreeQueries.empty()) glGenQueries( 1, &query );
+   else {
+      query = FreeQueries.back();
+      FreeQueries.pop_back();
+   }
+   return query;
+}
+
+void ProfilerGL::setEnabled(bool is_enabled)
+{
+   // The sections which are still on the GPU are finished, so a disabled profiler holds complete events.
+   if (IsEnabled && !is_enabled) collectQueryResults( true );
+   if (!IsEnabled && is_enabled) EventNum = 0;
+   IsEnabled = is_enabled;
+}
+
+void ProfilerGL::recordEvent(const char* name, int64_t start_time_in_us, int64_t end_time_in_us, GLuint query)
+{
+   const uint64_t event_index = EventNum++;
+   Event& event = Events[event_index % Events.size()];
+   event.Name = name;
+   event.Frame = Frame;
+   event.StartTimeInUs = start_time_in_us;
+   event.CPUDurationInUs = end_time_in_us - start_time_in_us;
+   event.GPUDurationInNs = -1;
+   if (query != 0) PendingQueries.push_back( { query, event_index, Frame } );
+}
+
+void ProfilerGL::collectQueryResults(bool wait_for_results)
+{
+   while (!PendingQueries.empty()) {
+      const PendingQuery& pending = PendingQueries.front();
+      if (!wait_for_results) {
+         if (pending.Frame + static_cast<uint64_t>(QueryLatency) > Frame) break;
+
+         GLint is_available = GL_FALSE;
+         glGetQueryObjectiv( pending.Query, GL_QUERY_RESULT_AVAILABLE, &is_available );
+         if (is_available == GL_FALSE) break;
+      }
+
+      GLuint64 elapsed_time_in_ns = 0;
+      glGetQueryObjectui64v( pending.Query, GL_QUERY_RESULT, &elapsed_time_in_ns );
+      // The event may already be overwritten if the ring is shorter than the query latency.
+      if (pending.EventIndex + Events.size() >= EventNum) {
+         Events[pending.EventIndex % Events.size()].GPUDurationInNs = static_cast<int64_t>(elapsed_time_in_ns);
+      }
+      FreeQueries.emplace_back( pending.Query );
+      PendingQueries.pop_front();
+   }
+}
+
+void ProfilerGL::endFrame()
+{
+   if (!IsEnabled) return;
+
+   Frame++;
+   collectQueryResults( false );
+}
+
+void ProfilerGL::forEachEvent(const std::function<void(const Event&)>& visitor) const
+{
+   const uint64_t capacity = Events.size();
+   const uint64_t first_index = EventNum > capacity ? EventNum - capacity : 0;
+   for (uint64_t i = first_index; i < EventNum; ++i) visitor( Events[i % capacity] );
+}
+
+void ProfilerGL::printStatistics() const
+{
+   struct Total
+   {
+      uint64_t Count = 0;
+      double CPUTimeInMs = 0.0;
+      uint64_t GPUCount = 0;
+      double GPUTimeInMs = 0.0;
+   };
+
+   // The sections are listed in the order they first appear in a frame.
+   std::vector<const char*> names;
+   std::map<std::string, Total> totals;
+   forEachEvent(
+      [&names, &totals](const Event& event)
+      {
+         auto it = totals.find( event.Name );
+         if (it == totals.end()) {
+            names.emplace_back( event.Name );
+            it = totals.emplace( event.Name, Total() ).first;
+         }
+         it->second.Count++;
+         it->second.CPUTimeInMs += static_cast<double>(event.CPUDurationInUs) * 1e-3;
+         if (event.GPUDurationInNs >= 0) {
+            it->second.GPUCount++;
+            it->second.GPUTimeInMs += static_cast<double>(event.GPUDurationInNs) * 1e-6;
+         }
+      }
+   );
+
+   std::cout << "Frame Profile (mean per call)\n";
+   std::cout << std::setw( 16 ) << "Section" << std::setw( 12 ) << "CPU" << std::setw( 12 ) << "GPU" << "\n";
+   for (const char* name : names) {
+      const Total& total = totals[name];
+      std::cout << std::setw( 16 ) << name << std::fixed << std::setprecision( 3 )
+         << std::setw( 9 ) << total.CPUTimeInMs / static_cast<double>(total.Count) << " ms";
+      if (total.GPUCount > 0) std::cout << std::setw( 9 ) << total.GPUTimeInMs / static_cast<double>(total.GPUCount) << " ms";
+      std::cout << std::defaultfloat << "\n";
+   }
+}
+
+bool ProfilerGL::exportChromeTrace(const std::string& file_path) const
+{
+   std::ofstream file(file_path);
+   if (!file.is_open()) {
+      std::cout << "Cannot Write the Trace to " << file_path << "...\n";
+      return false;
+   }
+
+   // Time-elapsed queries only measure durations, so the GPU events are placed where their sections were issued
+   // on the CPU. They are on their own track, and their lengths are what the GPU actually took.
+   file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+   file << R"({"name":"thread_name","ph":"M","pid":0,"tid":0,"args":{"name":"CPU"}},)" << "\n";
+   file << R"({"name":"thread_name","ph":"M","pid":0,"tid":1,"args":{"name":"GPU"}})";
+   file << std::fixed << std::setprecision( 3 );
+   forEachEvent(
+      [&file](const Event& event)
+      {
+         file << ",\n{\"name\":\"" << event.Name << "\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":0,\"tid\":0,\"ts\":"
+            << event.StartTimeInUs << ",\"dur\":" << event.CPUDurationInUs << ",\"args\":{\"frame\":" << event.Frame << "}}";
+         if (event.GPUDurationInNs >= 0) {
+            file << ",\n{\"name\":\"" << event.Name << "\",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":0,\"tid\":1,\"ts\":"
+               << event.StartTimeInUs << ",\"dur\":" << static_cast<double>(event.GPUDurationInNs) * 1e-3
+               << ",\"args\":{\"frame\":" << event.Frame << "}}";
+         }
+      }
+   );
+   file << "\n]}\n";
+   return true;
+}
+
+bool ProfilerGL::exportCSV(const std::string& file_path) const
+{
+   std::ofstream file(file_path);
+   if (!file.is_open()) {
+      std::cout << "Cannot Write the Profile to " << file_path << "...\n";
+      return false;
+   }
+
+   file << "frame,section,start_us,cpu_ms,gpu_ms\n";
+   file << std::fixed << std::setprecision( 4 );
+   forEachEvent(
+      [&file](const Event& event)
+      {
+         file << event.Frame << "," << event.Name << "," << event.StartTimeInUs << ","
+            << static_cast<double>(event.CPUDurationInUs) * 1e-3 << ",";
+         if (event.GPUDurationInNs >= 0) file << static_cast<double>(event.GPUDurationInNs) * 1e-6;
+         file << "\n";
+      }
+   );
+   return true;
+}
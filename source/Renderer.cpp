@@ -1,7 +1,11 @@
 #include "Renderer.h"
 
-RendererGL::RendererGL() : 
-   Window( nullptr ), FrameWidth( 1920 ), FrameHeight( 1080 ), IsVideo( true ), ClickedPoint( -1, -1 ),
+RendererGL::RendererGL(const Options& options) :
+   Settings( options ), Window( nullptr ), Context( std::make_unique<HeadlessContext>() ), OffscreenFramebuffer( 0 ),
+   OffscreenColorBuffer( 0 ), OffscreenDepthBuffer( 0 ), FrameWidth( options.Width ), FrameHeight( options.Height ),
+   CurrentSlideType( options.Slide ), DecoderType( options.Slide ),
+   UsePlanarYUV( true ), UseGeneratedSlide( false ), UseLegacyUpload( false ), UseLightCulling( true ), AreObjectBlocksDirty( true ), MainCameraRevision( 0 ),
+   ProjectorRevision( 0 ), SlideFormat( FrameSource::BGR ), ObjectBlocks{}, ClickedPoint( -1, -1 ),
    MainCamera( std::make_unique<CameraGL>() ),
    Projector( std::make_unique<CameraGL>( 
       glm::vec3{ 40.0f, 30.0f, 20.0f },
@@ -9,14 +13,17 @@ RendererGL::RendererGL() :
       glm::vec3{ 0.0f, 1.0f, 0.0f },
       30.0f, 10.0f, 60.0f
    ) ),
-   ObjectShader( std::make_unique<ShaderGL>() ), ProjectorPyramidObject( std::make_unique<ObjectGL>() ),
+   ObjectShader( std::make_unique<ShaderGL>() ), LightCullingShader( std::make_unique<ShaderGL>() ),
+   ShaderWatcher( std::make_unique<ShaderFileWatcher>() ),
+   ProjectorPyramidObject( std::make_unique<ObjectGL>() ),
    ScreenObject( std::make_unique<ObjectGL>() ), WallObject( std::make_unique<ObjectGL>() ),
-   Lights( std::make_unique<LightGL>() )
+   Lights( std::make_unique<LightGL>() ), Clock( std::make_unique<PlaybackClock>() ),
+   Recorder( std::make_unique<FrameRecorder>() ), Profiler( std::make_unique<ProfilerGL>() )
 {
    Renderer = this;
 
    initialize();
-   printOpenGLInformation();
+   if (hasContext()) printOpenGLInformation();
 }
 
 void RendererGL::printOpenGLInformation()
@@ -29,26 +36,110 @@ void RendererGL::printOpenGLInformation()
    std::cout << "****************************************************************\n\n";
 }
 
-void RendererGL::initialize()
+bool RendererGL::parseArguments(int argc, char** argv, Options& options)
 {
-   if (!glfwInit()) {
-      std::cout << "Cannot Initialize OpenGL...\n";
-      return;
+   for (int i = 1; i < argc; ++i) {
+      const std::string argument = argv[i];
+      const bool has_value = i + 1 < argc;
+      bool is_valid = true;
+      if (argument == "--headless") options.IsHeadless = true;
+      else if (argument == "--size" && has_value) {
+         is_valid = std::sscanf( argv[++i], "%dx%d", &options.Width, &options.Height ) == 2 &&
+            options.Width > 0 && options.Height > 0;
+      }
+      else if (argument == "--slide" && has_value) {
+         const std::string slide = argv[++i];
+         if (slide == "image") options.Slide = STILL_IMAGE;
+         else if (slide == "video") options.Slide = VIDEO;
+         else if (slide == "sequence") options.Slide = IMAGE_SEQUENCE;
+         else if (slide == "live") options.Slide = LIVE;
+         else is_valid = false;
+      }
+      else if (argument == "--frames" && has_value) {
+         options.FrameNum = std::atoi( argv[++i] );
+         is_valid = options.FrameNum >= 0;
+      }
+      else if (argument == "--fps" && has_value) {
+         options.FPS = std::atof( argv[++i] );
+         is_valid = options.FPS >= 0.0;
+      }
+      else if (argument == "--output" && has_value) options.OutputPath = argv[++i];
+      else if (argument == "--mesh" && has_value) options.MeshPath = argv[++i];
+      else is_valid = false;
+
+      if (!is_valid) {
+         std::cout << "Cannot Parse the Argument '" << argument << "'...\n";
+         std::cout << "Usage: SlideProjector [--headless] [--size WxH] [--slide image|video|sequence|live] "
+            "[--frames N] [--fps F] [--output PATH] [--mesh PATH]\n";
+         return false;
+      }
    }
+   return true;
+}
+
+bool RendererGL::createContext()
+{
+   // A surfaceless EGL context needs no display at all. If it is not available, the headless mode falls back
+   // to an invisible window, which still needs a display server but nothing is shown on it.
+   if (Settings.IsHeadless && Context->create( 4, 5 )) {
+      return gladLoadGLLoader( HeadlessContext::getProcAddress ) != 0;
+   }
+
+   if (!glfwInit()) return false;
    glfwWindowHint( GLFW_CONTEXT_VERSION_MAJOR, 4 );
-   glfwWindowHint( GLFW_CONTEXT_VERSION_MINOR, 6 );
+   glfwWindowHint( GLFW_CONTEXT_VERSION_MINOR, 5 );
    glfwWindowHint( GLFW_DOUBLEBUFFER, GLFW_TRUE );
    glfwWindowHint( GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE );
+   glfwWindowHint( GLFW_VISIBLE, Settings.IsHeadless ? GLFW_FALSE : GLFW_TRUE );
 
    Window = glfwCreateWindow( FrameWidth, FrameHeight, "Main Camera", nullptr, nullptr );
+   if (Window == nullptr) return false;
    glfwMakeContextCurrent( Window );
+   return gladLoadGLLoader( reinterpret_cast<GLADloadproc>(glfwGetProcAddress) ) != 0;
+}
 
-   if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
-      std::cout << "Failed to initialize GLAD" << std::endl;
+bool RendererGL::createOffscreenFramebuffer()
+{
+   glCreateRenderbuffers( 1, &OffscreenColorBuffer );
+   glNamedRenderbufferStorage( OffscreenColorBuffer, GL_RGBA8, FrameWidth, FrameHeight );
+   glCreateRenderbuffers( 1, &OffscreenDepthBuffer );
+   glNamedRenderbufferStorage( OffscreenDepthBuffer, GL_DEPTH_COMPONENT24, FrameWidth, FrameHeight );
+
+   glCreateFramebuffers( 1, &OffscreenFramebuffer );
+   glNamedFramebufferRenderbuffer( OffscreenFramebuffer, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, OffscreenColorBuffer );
+   glNamedFramebufferRenderbuffer( OffscreenFramebuffer, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, OffscreenDepthBuffer );
+   if (glCheckNamedFramebufferStatus( OffscreenFramebuffer, GL_FRAMEBUFFER ) != GL_FRAMEBUFFER_COMPLETE) {
+      std::cout << "Cannot Create the Offscreen Framebuffer...\n";
+      deleteOffscreenFramebuffer();
+      return false;
+   }
+
+   // The surfaceless context has no default framebuffer, so its viewport starts out empty.
+   glBindFramebuffer( GL_FRAMEBUFFER, OffscreenFramebuffer );
+   glViewport( 0, 0, FrameWidth, FrameHeight );
+   return true;
+}
+
+void RendererGL::deleteOffscreenFramebuffer()
+{
+   if (OffscreenFramebuffer != 0) {
+      glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+      glDeleteFramebuffers( 1, &OffscreenFramebuffer );
+   }
+   if (OffscreenColorBuffer != 0) glDeleteRenderbuffers( 1, &OffscreenColorBuffer );
+   if (OffscreenDepthBuffer != 0) glDeleteRenderbuffers( 1, &OffscreenDepthBuffer );
+   OffscreenFramebuffer = OffscreenColorBuffer = OffscreenDepthBuffer = 0;
+}
+
+void RendererGL::initialize()
+{
+   if (!createContext()) {
+      std::cout << "Cannot Initialize OpenGL...\n";
       return;
    }
-   
-   registerCallbacks();
+
+   if (Window != nullptr) registerCallbacks();
+   if (Settings.IsHeadless && !createOffscreenFramebuffer()) return;
    
    glEnable( GL_DEPTH_TEST );
    glClearColor( 0.1f, 0.1f, 0.1f, 1.0f );
@@ -56,10 +147,33 @@ void RendererGL::initialize()
    MainCamera->updateWindowSize( FrameWidth, FrameHeight );
 
    const std::string shader_directory_path = std::string(CMAKE_SOURCE_DIR) + "/shaders";
-   ObjectShader->setShader(
+   ShaderGL::setProgramCacheDirectory( std::string(CMAKE_BINARY_DIR) + "/shader_cache" );
+   ShaderGL::initializeParallelCompilation(
+      Window != nullptr ? reinterpret_cast<GLADloadproc>(glfwGetProcAddress) : HeadlessContext::getProcAddress
+   );
+   ObjectShader->setShaderPermutations(
       std::string(shader_directory_path + "/SlideProjector.vert").c_str(),
-      std::string(shader_directory_path + "/SlideProjector.frag").c_str()
+      std::string(shader_directory_path + "/SlideProjector.frag").c_str(),
+      { "PROJECT_SLIDE", "USE_LIGHTING", "SAMPLE_SLIDE" },
+      { FLAT_COLOR, LIT_WALL, USE_LIGHTING, SAMPLE_SLIDE }
    );
+   // The lights are culled twice, once to count the lights of the clusters and once to write them.
+   const std::string light_culling_path = shader_directory_path + "/LightCulling.comp";
+   LightCullingShader->setComputeShaders(
+      {
+         std::string(shader_directory_path + "/LightTransform.comp").c_str(),
+         light_culling_path.c_str(),
+         std::string(shader_directory_path + "/LightListOffsets.comp").c_str(),
+         light_culling_path.c_str()
+      },
+      { std::string(), "COUNT_LIGHTS", std::string(), std::string() }
+   );
+   // Every program is submitted before any of them is waited for, so the driver compiles them in parallel.
+   ObjectShader->waitForPendingPrograms();
+   LightCullingShader->waitForPendingPrograms();
+   ShaderGL::printProgramCacheStatistics();
+   // Batch renders do not edit the shaders while they run.
+   if (!Settings.IsHeadless) ShaderWatcher->start( shader_directory_path );
 }
 
 void RendererGL::error(int error, const char* description) const
@@ -110,19 +224,56 @@ void RendererGL::keyboard(GLFWwindow* window, int key, int scancode, int action,
          Projector->resetCamera();
          break;
       case GLFW_KEY_R:
-         if (IsVideo) {
-            prepareSlide();
+         if (isMovingSlide()) {
+            Decoder->printStatistics();
+            Clock->start( Decoder->seekToFrame( 0 ) );
             std::cout << "Replay Video!\n";
          }
          break;
+      case GLFW_KEY_LEFT_BRACKET:
+         if (isMovingSlide()) seekVideo( Decoder->getClipTime( Clock->getTime() ) - 5000.0 );
+         break;
+      case GLFW_KEY_RIGHT_BRACKET:
+         if (isMovingSlide()) seekVideo( Decoder->getClipTime( Clock->getTime() ) + 5000.0 );
+         break;
       case GLFW_KEY_L:
          Lights->toggleLightSwitch();
          std::cout << "Light Turned " << (Lights->isLightOn() ? "On!\n" : "Off!\n");
          break;
+      case GLFW_KEY_C:
+         UseLightCulling = !UseLightCulling;
+         std::cout << "Clustered Light Culling " << (UseLightCulling ? "On!\n" : "Off!\n");
+         break;
+      case GLFW_KEY_B:
+         benchmarkLights();
+         break;
+      case GLFW_KEY_V:
+         toggleRecording();
+         break;
+      case GLFW_KEY_P:
+         toggleProfiler();
+         break;
       case GLFW_KEY_ENTER:
-         IsVideo = !IsVideo;
+         CurrentSlideType = static_cast<SlideType>((CurrentSlideType + 1) % (LIVE + 1));
          prepareSlide();
          break;
+      case GLFW_KEY_SPACE:
+         if (isMovingSlide()) {
+            if (Clock->isPaused()) Clock->resume();
+            else Clock->pause();
+         }
+         break;
+      case GLFW_KEY_O:
+         if (Decoder == nullptr) break;
+         Decoder->setLooping( !Decoder->isLooping() );
+         std::cout << "Video Looping " << (Decoder->isLooping() ? "On!\n" : "Off!\n");
+         break;
+      case GLFW_KEY_Y:
+         UsePlanarYUV = !UsePlanarYUV;
+         std::cout << "Planar YUV Upload " << (UsePlanarYUV ? "On!\n" : "Off!\n");
+         if (Decoder != nullptr) Decoder->close();
+         if (isMovingSlide()) prepareSlide();
+         break;
       case GLFW_KEY_Q:
       case GLFW_KEY_ESCAPE:
          cleanupWrapper( window );
@@ -198,6 +349,12 @@ void RendererGL::mousewheelWrapper(GLFWwindow* window, double xoffset, double yo
 
 void RendererGL::reshape(GLFWwindow* window, int width, int height) const
 {
+   if (Recorder->isRecording()) {
+      // The readback buffers are sized for the framebuffer which the recording started with.
+      Recorder->stop();
+      Recorder->printStatistics();
+      std::cout << "Recording Stopped; the Window Was Resized!\n";
+   }
    MainCamera->updateWindowSize( width, height );
    glViewport( 0, 0, width, height );
 }
@@ -229,83 +386,162 @@ void RendererGL::setLights() const
 
 void RendererGL::setWallObject() const
 {
+   if (!Settings.MeshPath.empty()) {
+      if (WallObject->setMeshObject( Settings.MeshPath )) {
+         WallObject->setDiffuseReflectionColor( { 0.8f, 0.8f, 0.8f, 1.0f } );
+         return;
+      }
+      std::cout << "The built-in wall is projected onto instead...\n";
+   }
+
+   // The back wall, the floor and the side wall share their corners only within each face, as the normals differ.
    constexpr float size = 30.0f;
    std::vector<glm::vec3> wall_vertices;
    wall_vertices.emplace_back( size, 0.0f, 0.0f );
    wall_vertices.emplace_back( size, size, 0.0f );
    wall_vertices.emplace_back( 0.0f, size, 0.0f );
-   
-   wall_vertices.emplace_back( size, 0.0f, 0.0f );
-   wall_vertices.emplace_back( 0.0f, size, 0.0f );
    wall_vertices.emplace_back( 0.0f, 0.0f, 0.0f );
 
    wall_vertices.emplace_back( size, 0.0f, size );
    wall_vertices.emplace_back( size, 0.0f, 0.0f );
    wall_vertices.emplace_back( 0.0f, 0.0f, 0.0f );
-   
-   wall_vertices.emplace_back( size, 0.0f, size );
-   wall_vertices.emplace_back( 0.0f, 0.0f, 0.0f );
    wall_vertices.emplace_back( 0.0f, 0.0f, size );
 
    wall_vertices.emplace_back( 0.0f, 0.0f, 0.0f );
    wall_vertices.emplace_back( 0.0f, size, 0.0f );
    wall_vertices.emplace_back( 0.0f, size, size );
-   
-   wall_vertices.emplace_back( 0.0f, 0.0f, 0.0f );
-   wall_vertices.emplace_back( 0.0f, size, size );
    wall_vertices.emplace_back( 0.0f, 0.0f, size );
 
    std::vector<glm::vec3> wall_normals;
-   wall_normals.emplace_back( 0.0f, 0.0f, 1.0f );
-   wall_normals.emplace_back( 0.0f, 0.0f, 1.0f );
-   wall_normals.emplace_back( 0.0f, 0.0f, 1.0f );
-   
-   wall_normals.emplace_back( 0.0f, 0.0f, 1.0f );
-   wall_normals.emplace_back( 0.0f, 0.0f, 1.0f );
-   wall_normals.emplace_back( 0.0f, 0.0f, 1.0f );
+   for (int i = 0; i < 4; ++i) wall_normals.emplace_back( 0.0f, 0.0f, 1.0f );
+   for (int i = 0; i < 4; ++i) wall_normals.emplace_back( 0.0f, 1.0f, 0.0f );
+   for (int i = 0; i < 4; ++i) wall_normals.emplace_back( 1.0f, 0.0f, 0.0f );
+
+   std::vector<uint32_t> wall_indices;
+   for (uint32_t face = 0; face < 3; ++face) {
+      const uint32_t corner = face * 4;
+      wall_indices.insert( wall_indices.end(), { corner, corner + 1, corner + 2, corner, corner + 2, corner + 3 } );
+   }
 
-   wall_normals.emplace_back( 0.0f, 1.0f, 0.0f );
-   wall_normals.emplace_back( 0.0f, 1.0f, 0.0f );
-   wall_normals.emplace_back( 0.0f, 1.0f, 0.0f );
-   
-   wall_normals.emplace_back( 0.0f, 1.0f, 0.0f );
-   wall_normals.emplace_back( 0.0f, 1.0f, 0.0f );
-   wall_normals.emplace_back( 0.0f, 1.0f, 0.0f );
-  
-   wall_normals.emplace_back( 1.0f, 0.0f, 0.0f );
-   wall_normals.emplace_back( 1.0f, 0.0f, 0.0f );
-   wall_normals.emplace_back( 1.0f, 0.0f, 0.0f );
-   
-   wall_normals.emplace_back( 1.0f, 0.0f, 0.0f );
-   wall_normals.emplace_back( 1.0f, 0.0f, 0.0f );
-   wall_normals.emplace_back( 1.0f, 0.0f, 0.0f );
-      
    WallObject->setObject( GL_TRIANGLES, wall_vertices, wall_normals );
+   WallObject->setIndices( wall_indices, true );
    WallObject->setDiffuseReflectionColor( { 0.52f, 0.12f, 0.15f, 1.0f } );
 }
 
+std::unique_ptr<FrameSource> RendererGL::createDecoder(SlideType type)
+{
+   if (type == LIVE) return std::make_unique<SharedMemorySource>();
+   if (type == IMAGE_SEQUENCE) {
+      auto decoder = std::make_unique<ImageSequenceDecoder>( 60.0 );
+      decoder->setLooping( true );
+      return decoder;
+   }
+
+   // 10 seconds of 1080p I420 frames at 30 fps fit in 1 GiB, which covers the short loops we project.
+   // The single-clip playlist wraps around while looping, so the last frame is followed by the first without a reopen.
+   auto decoder = std::make_unique<VideoDecoder>();
+   decoder->setFrameCacheBudget( size_t{ 1024 } * 1024 * 1024 );
+   decoder->setLooping( true );
+   return decoder;
+}
+
 void RendererGL::prepareSlide()
 {
    static const std::string sample_directory_path = std::string(CMAKE_SOURCE_DIR) + "/samples";
    static const std::string image_path = sample_directory_path + "/image.jpg";
    static const std::string video_path = sample_directory_path + "/video.mp4";
+   static const std::string sequence_path = sample_directory_path + "/sequence";
+   static const std::string live_frame_ring_name = "/SlideProjector";
 
-   if (!IsVideo) {
-      Slide = cv::imread( image_path );
+   if (UseGeneratedSlide) {
+      generateSlide( Slide, 0 );
+      SlideFormat = FrameSource::BGR;
       Projector->updateWindowSize( Slide.cols / 100, Slide.rows / 100 );
+      allocateSlideTextures( Slide.cols, Slide.rows );
+      uploadSlide( Slide );
+      return;
    }
-   else {
-      if (Video.isOpened()) Video.release();
 
-      Video.open( video_path );
-      if (!Video.isOpened()) {
-         std::cout << "Cannot Read Video File...\n";
-         return;
+   // The decoder and the video textures are kept while the still image is shown,
+   // so switching back to the same kind of slide only seeks to the first frame.
+   if (CurrentSlideType == STILL_IMAGE) {
+      Clock->pause();
+      if (StillImage.empty()) {
+         StillImage = cv::imread( image_path );
+         ScreenObject->reallocateTexture( StillImage, IMAGE );
       }
-      Video >> Slide;
-      Projector->updateWindowSize( Slide.cols / 100, Slide.rows / 100 );
+      Projector->updateWindowSize( StillImage.cols / 100, StillImage.rows / 100 );
+   }
+   else if (Decoder != nullptr && Decoder->isOpened() && DecoderType == CurrentSlideType) {
+      Projector->updateWindowSize( Decoder->getFrameWidth() / 100, Decoder->getFrameHeight() / 100 );
+      Clock->start( Decoder->seekToFrame( 0 ) );
+   }
+   else {
+      if (Decoder == nullptr || DecoderType != CurrentSlideType) {
+         Decoder = createDecoder( CurrentSlideType );
+         DecoderType = CurrentSlideType;
+      }
+      const std::string& path = CurrentSlideType == VIDEO ? video_path :
+                                CurrentSlideType == IMAGE_SEQUENCE ? sequence_path : live_frame_ring_name;
+      if (!Decoder->open( path, Slide, UsePlanarYUV )) return;
+      SlideFormat = Decoder->getPixelFormat();
+      const int width = Decoder->getFrameWidth();
+      const int height = Decoder->getFrameHeight();
+      Projector->updateWindowSize( width / 100, height / 100 );
+      allocateSlideTextures( width, height );
+      uploadSlide( Slide );
+      Clock->start( Decoder->getFirstFrameTime() );
    }
-   ScreenObject->reallocateTexture( Slide, 0 );
+}
+
+void RendererGL::seekVideo(double time_in_ms) const
+{
+   const bool is_paused = Clock->isPaused();
+   Clock->start( Decoder->seekToTime( time_in_ms ) );
+   if (is_paused) Clock->pause();
+}
+
+void RendererGL::allocateSlideTextures(int width, int height) const
+{
+   // Planar YUV keeps the luma in the texture 0 and the chroma in the textures 1 and 2 (I420) or 1 (NV12).
+   switch (SlideFormat) {
+      case FrameSource::I420:
+         ScreenObject->reallocateTexture( width, height, GL_R8, VIDEO0 );
+         ScreenObject->reallocateTexture( width / 2, height / 2, GL_R8, VIDEO1 );
+         ScreenObject->reallocateTexture( width / 2, height / 2, GL_R8, VIDEO2 );
+         ScreenObject->prepareStreamingTexture( VIDEO0, width, height, GL_RED );
+         ScreenObject->prepareStreamingTexture( VIDEO1, width / 2, height / 2, GL_RED );
+         ScreenObject->prepareStreamingTexture( VIDEO2, width / 2, height / 2, GL_RED );
+         break;
+      case FrameSource::NV12:
+         ScreenObject->reallocateTexture( width, height, GL_R8, VIDEO0 );
+         ScreenObject->reallocateTexture( width / 2, height / 2, GL_RG8, VIDEO1 );
+         ScreenObject->prepareStreamingTexture( VIDEO0, width, height, GL_RED );
+         ScreenObject->prepareStreamingTexture( VIDEO1, width / 2, height / 2, GL_RG );
+         break;
+      default:
+         if (UseLegacyUpload) ScreenObject->reallocateTexture( width, height, GL_RGBA8, VIDEO0 );
+         else {
+            ScreenObject->reallocateTexture( Slide, VIDEO0 );
+            ScreenObject->prepareStreamingTexture( VIDEO0, width, height, GL_RGB );
+         }
+         break;
+   }
+}
+
+void RendererGL::uploadSlide(const cv::Mat& frame) const
+{
+   if (SlideFormat == FrameSource::BGR) {
+      // The legacy upload is flipped for the texture coordinates of that time, so the slide is projected upside down.
+      if (UseLegacyUpload) ScreenObject->updateTextureWithFlip( frame, VIDEO0 );
+      else ScreenObject->streamTexture( frame, VIDEO0 );
+      return;
+   }
+
+   const size_t luma_size = static_cast<size_t>(frame.cols) * frame.rows * 2 / 3;
+   ScreenObject->streamTexture( frame.data, VIDEO0 );
+   ScreenObject->streamTexture( frame.data + luma_size, VIDEO1 );
+   if (SlideFormat == FrameSource::I420) ScreenObject->streamTexture( frame.data + luma_size * 5 / 4, VIDEO2 );
 }
 
 void RendererGL::setScreenObject()
@@ -319,21 +555,17 @@ void RendererGL::setScreenObject()
    screen_vertices.emplace_back( half_width, -half_height, -near_plane );
    screen_vertices.emplace_back( half_width, half_height, -near_plane );
    screen_vertices.emplace_back( -half_width, half_height, -near_plane );
-   
-   screen_vertices.emplace_back( half_width, -half_height, -near_plane );
-   screen_vertices.emplace_back( -half_width, half_height, -near_plane );
    screen_vertices.emplace_back( -half_width, -half_height, -near_plane );
 
+   // The slide is uploaded top row first, so its texture coordinates are flipped vertically.
    std::vector<glm::vec2> screen_textures;
-   screen_textures.emplace_back( 1.0f, 0.0f );
    screen_textures.emplace_back( 1.0f, 1.0f );
-   screen_textures.emplace_back( 0.0f, 1.0f );
-   
    screen_textures.emplace_back( 1.0f, 0.0f );
-   screen_textures.emplace_back( 0.0f, 1.0f );
    screen_textures.emplace_back( 0.0f, 0.0f );
-      
-   ScreenObject->setObject( GL_TRIANGLES, screen_vertices, screen_textures, Slide );
+   screen_textures.emplace_back( 0.0f, 1.0f );
+
+   ScreenObject->setObject( GL_TRIANGLES, screen_vertices, screen_textures );
+   ScreenObject->setIndices( { 0, 1, 2, 0, 2, 3 } );
 }
 
 void RendererGL::setProjectorPyramidObject() const
@@ -343,89 +575,176 @@ void RendererGL::setProjectorPyramidObject() const
    const float half_width = static_cast<float>(Projector->getWidth()) * 0.5f * far_plane / near_plane;
    const float half_height = static_cast<float>(Projector->getHeight()) * 0.5f * far_plane / near_plane;
 
+   // The apex is at the projector and the base is the far plane; the lines connect the apex to each corner
+   // and then the corners around the base.
    std::vector<glm::vec3> pyramid_vertices;
    pyramid_vertices.emplace_back( 0.0f, 0.0f, 0.0f );
    pyramid_vertices.emplace_back( -half_width, half_height, -far_plane );
-
-   pyramid_vertices.emplace_back( 0.0f, 0.0f, 0.0f );
    pyramid_vertices.emplace_back( half_width, half_height, -far_plane );
-
-   pyramid_vertices.emplace_back( 0.0f, 0.0f, 0.0f );
    pyramid_vertices.emplace_back( half_width, -half_height, -far_plane );
-
-   pyramid_vertices.emplace_back( 0.0f, 0.0f, 0.0f );
    pyramid_vertices.emplace_back( -half_width, -half_height, -far_plane );
 
-   pyramid_vertices.emplace_back( -half_width, half_height, -far_plane );
-   pyramid_vertices.emplace_back( half_width, half_height, -far_plane );
+   ProjectorPyramidObject->setObject( GL_LINES, pyramid_vertices );
+   ProjectorPyramidObject->setIndices( { 0, 1, 0, 2, 0, 3, 0, 4, 1, 2, 2, 3, 3, 4, 4, 1 } );
+   ProjectorPyramidObject->setDiffuseReflectionColor( { 1.0f, 1.0f, 0.0f, 1.0f } );
+}
 
-   pyramid_vertices.emplace_back( half_width, half_height, -far_plane );
-   pyramid_vertices.emplace_back( half_width, -half_height, -far_plane );
+void RendererGL::transferSlideToShader() const
+{
+   if (CurrentSlideType == STILL_IMAGE) {
+      glBindTextureUnit( 0, ScreenObject->getTextureID( IMAGE ) );
+      return;
+   }
 
-   pyramid_vertices.emplace_back( half_width, -half_height, -far_plane );
-   pyramid_vertices.emplace_back( -half_width, -half_height, -far_plane );
+   const int texture_num = SlideFormat == FrameSource::I420 ? 3 : SlideFormat == FrameSource::NV12 ? 2 : 1;
+   for (int i = 0; i < texture_num && i < ScreenObject->getTextureNum(); ++i) {
+      glBindTextureUnit( i, ScreenObject->getTextureID( VIDEO0 + i ) );
+   }
+}
 
-   pyramid_vertices.emplace_back( -half_width, -half_height, -far_plane );
-   pyramid_vertices.emplace_back( -half_width, half_height, -far_plane );
+void RendererGL::transferUniformBlocks()
+{
+   ShaderGL::FrameUniformBlock frame{};
+   frame.ViewMatrix = MainCamera->getViewMatrix();
+   frame.ProjectionMatrix = MainCamera->getProjectionMatrix();
+   frame.SlideFormat = CurrentSlideType == STILL_IMAGE ? FrameSource::BGR : SlideFormat;
+   frame.InverseProjectionMatrix = MainCamera->getInverseProjectionMatrix();
+
+   // The depth slices are exponential, so the slice of a fragment is linear in log(-z).
+   const auto width = static_cast<float>(MainCamera->getWidth());
+   const auto height = static_cast<float>(MainCamera->getHeight());
+   const float near_plane = MainCamera->getNearPlane();
+   const float far_plane = MainCamera->getFarPlane();
+   const float slice_scale = static_cast<float>(LightGL::ClusterNumZ) / std::log( far_plane / near_plane );
+   frame.LightCluster = glm::ivec4(
+      LightGL::ClusterNumX, LightGL::ClusterNumY, LightGL::ClusterNumZ, UseLightCulling ? 1 : 0
+   );
+   frame.ClusterDepth = glm::vec4(near_plane, far_plane, slice_scale, -slice_scale * std::log( near_plane ));
+   frame.Viewport = glm::vec4(
+      width, height,
+      std::ceil( width / static_cast<float>(LightGL::ClusterNumX) ),
+      std::ceil( height / static_cast<float>(LightGL::ClusterNumY) )
+   );
+   ObjectShader->updateFrameUniformBlock( frame );
+
+   // The objects do not move on their own, so their matrices only change with the cameras.
+   if (!AreObjectBlocksDirty && MainCameraRevision == MainCamera->getRevision() &&
+       ProjectorRevision == Projector->getRevision()) return;
+
+   // Only the wall is projected on. The bias maps the clip coordinates of the projector to [0, w] with y flipped,
+   // as the slide is stored top row first.
+   const glm::mat4 projector_texture_bias(
+      0.5f, 0.0f, 0.0f, 0.0f,
+      0.0f, -0.5f, 0.0f, 0.0f,
+      0.0f, 0.0f, 0.0f, 0.0f,
+      0.5f, 0.5f, 1.0f, 1.0f
+   );
 
-   ProjectorPyramidObject->setObject( GL_LINES, pyramid_vertices );
-   ProjectorPyramidObject->setDiffuseReflectionColor( { 1.0f, 1.0f, 0.0f, 1.0f } );
+   // The screen and the projector pyramid are placed at the projector.
+   const glm::mat4& projector_to_world = Projector->getInverseViewMatrix();
+   ShaderGL::getBasicTransformationBlock( ObjectBlocks[WALL], glm::mat4(1.0f), MainCamera.get(), true );
+   ShaderGL::getBasicTransformationBlock( ObjectBlocks[SCREEN], projector_to_world, MainCamera.get(), true );
+   ShaderGL::getBasicTransformationBlock( ObjectBlocks[PROJECTOR], projector_to_world, MainCamera.get() );
+   ObjectBlocks[WALL].ProjectorTextureMatrix = projector_texture_bias * Projector->getViewProjectionMatrix();
+   WallObject->transferUniformsToBlock( ObjectBlocks[WALL] );
+   ScreenObject->transferUniformsToBlock( ObjectBlocks[SCREEN] );
+   ProjectorPyramidObject->transferUniformsToBlock( ObjectBlocks[PROJECTOR] );
+   ObjectShader->updateObjectUniformBlocks( ObjectBlocks.data(), static_cast<int>(ObjectBlocks.size()) );
+
+   MainCameraRevision = MainCamera->getRevision();
+   ProjectorRevision = Projector->getRevision();
+   AreObjectBlocksDirty = false;
 }
 
-void RendererGL::drawWallObject() const
+void RendererGL::drawObject(const ObjectGL* object)
 {
-   glUseProgram( ObjectShader->getShaderProgram() );
+   glBindVertexArray( object->getVAO() );
+   if (object->isIndexed()) {
+      glDrawElements( object->getDrawMode(), object->getIndexNum(), object->getIndexType(), nullptr );
+   }
+   else glDrawArrays( object->getDrawMode(), 0, object->getVertexNum() );
+}
 
-   ObjectShader->transferBasicTransformationUniforms( glm::mat4(1.0f), MainCamera.get(), true );
-   const glm::mat4& view = Projector->getViewMatrix();
-   const glm::mat4& projection = Projector->getProjectionMatrix();
-   glUniformMatrix4fv( ObjectShader->getLocation( "ProjectorViewMatrix" ), 1, GL_FALSE, &view[0][0] );
-   glUniformMatrix4fv( ObjectShader->getLocation( "ProjectorProjectionMatrix" ), 1, GL_FALSE, &projection[0][0] );
-   glUniform1i( ObjectShader->getLocation( "WhichObject" ), WALL );
+void RendererGL::drawObjectChunks(const ObjectGL* object, const std::vector<BoundingVolumeHierarchy::Chunk>& chunks)
+{
+   glBindVertexArray( object->getVAO() );
+   const GLsizeiptr index_size = object->getIndexType() == GL_UNSIGNED_SHORT ? sizeof( uint16_t ) : sizeof( uint32_t );
+   for (const auto& chunk : chunks) {
+      glDrawElements(
+         object->getDrawMode(), static_cast<GLsizei>(chunk.IndexNum), object->getIndexType(),
+         reinterpret_cast<const void*>(index_size * chunk.FirstIndex)
+      );
+   }
+}
 
-   WallObject->transferUniformsToShader( ObjectShader.get() );
-   Lights->transferUniformsToShader( ObjectShader.get() );
+void RendererGL::drawWallObject()
+{
+   const ProfilerGL::Scope scope( Profiler.get(), "drawWallObject", true );
+   // Without the lights, the wall is drawn in its own color and the slide is not projected on it.
+   const bool is_lit = Lights->isLightOn();
+   const BoundingVolumeHierarchy* bvh = WallObject->getBoundingVolumeHierarchy();
+   if (bvh == nullptr) {
+      glUseProgram( ObjectShader->getShaderProgram( is_lit ? LIT_WALL : FLAT_COLOR ) );
+      ObjectShader->bindObjectUniformBlock( WALL );
+      drawObject( WallObject.get() );
+      return;
+   }
 
-   glBindTextureUnit( 0, ScreenObject->getTextureID( 0 ) );
-   glBindVertexArray( WallObject->getVAO() );
-   glDrawArrays( WallObject->getDrawMode(), 0, WallObject->getVertexNum() );
+   // The wall is not transformed, so its chunks are culled with the frustums as they are in the world space.
+   // The projective texture test of the chunks which the projector cannot reach would only return the wall color,
+   // so they are drawn with the lighting alone.
+   bvh->cull(
+      MainCamera->getViewProjectionMatrix(), Projector->getViewProjectionMatrix(),
+      ProjectedWallChunks, UnprojectedWallChunks
+   );
+   glUseProgram( ObjectShader->getShaderProgram( is_lit ? LIT_WALL : FLAT_COLOR ) );
+   ObjectShader->bindObjectUniformBlock( WALL );
+   drawObjectChunks( WallObject.get(), ProjectedWallChunks );
+   if (is_lit) glUseProgram( ObjectShader->getShaderProgram( USE_LIGHTING ) );
+   drawObjectChunks( WallObject.get(), UnprojectedWallChunks );
 }
 
 void RendererGL::drawScreenObject() const
 {
-   glUseProgram( ObjectShader->getShaderProgram() );
-
-   const glm::mat4 to_world = inverse( Projector->getViewMatrix() );
-   ObjectShader->transferBasicTransformationUniforms( to_world, MainCamera.get(), true );
-   glUniform1i( ObjectShader->getLocation( "WhichObject" ), SCREEN );
+   const ProfilerGL::Scope scope( Profiler.get(), "drawScreenObject", true );
+   glUseProgram( ObjectShader->getShaderProgram( SAMPLE_SLIDE ) );
+   ObjectShader->bindObjectUniformBlock( SCREEN );
 
-   ScreenObject->transferUniformsToShader( ObjectShader.get() );
-
-   glBindTextureUnit( 0, ScreenObject->getTextureID( 0 ) );
-   glBindVertexArray( ScreenObject->getVAO() );
-   glDrawArrays( ScreenObject->getDrawMode(), 0, ScreenObject->getVertexNum() );
+   drawObject( ScreenObject.get() );
 }
 
 void RendererGL::drawProjectorObject() const
 {
-   glUseProgram( ObjectShader->getShaderProgram() );
+   const ProfilerGL::Scope scope( Profiler.get(), "drawProjectorObject", true );
    glLineWidth( 3.0f );
+   glUseProgram( ObjectShader->getShaderProgram( FLAT_COLOR ) );
+   ObjectShader->bindObjectUniformBlock( PROJECTOR );
 
-   const glm::mat4 to_world = inverse( Projector->getViewMatrix() );
-   ObjectShader->transferBasicTransformationUniforms( to_world, MainCamera.get() );
-   glUniform1i( ObjectShader->getLocation( "WhichObject" ), PROJECTOR );
+   drawObject( ProjectorPyramidObject.get() );
+   glLineWidth( 1.0f );
+}
 
-   ProjectorPyramidObject->transferUniformsToShader( ObjectShader.get() );
+void RendererGL::transferLightsToShader() const
+{
+   const ProfilerGL::Scope scope( Profiler.get(), "transferLightsToShader", true );
+   Lights->transferLightsToShader();
+   if (!Lights->isLightOn()) return;
 
-   glBindVertexArray( ProjectorPyramidObject->getVAO() );
-   glDrawArrays( ProjectorPyramidObject->getDrawMode(), 0, ProjectorPyramidObject->getVertexNum() );
-   glLineWidth( 1.0f );
+   Lights->transformLightsToView( LightCullingShader.get() );
+   if (UseLightCulling) Lights->cullLights( LightCullingShader.get() );
 }
 
-void RendererGL::render() const
+void RendererGL::render()
 {
    glClear( OPENGL_COLOR_BUFFER_BIT | OPENGL_DEPTH_BUFFER_BIT );
 
+   // The light culling reads the frame block, so the blocks are written before the lights are binned.
+   // The blocks and textures are bound to fixed points, so they are shared by every variant of the program,
+   // and only the object slice is rebound per draw.
+   transferUniformBlocks();
+   transferLightsToShader();
+   transferSlideToShader();
+
    drawWallObject();
    drawScreenObject();
    drawProjectorObject();
@@ -434,35 +753,406 @@ void RendererGL::render() const
    glUseProgram( 0 );
 }
 
-void RendererGL::setNextSlide()
+void RendererGL::benchmarkLights()
 {
-   if (IsVideo) {
-      Video >> Slide;
-      if (Slide.empty()) return;
+   // Point lights with a short falloff are scattered in the room, so each of them only reaches a few clusters.
+   // The frames are timed on the GPU with every light shaded per fragment and with the clustered lights.
+   // The light indices are the entries of the clusters' index list, which grows before the timed frames.
+   if (!Lights->isLightOn()) {
+      std::cout << "Cannot Benchmark Lights While the Light Is Off...\n";
+      return;
+   }
+
+   constexpr std::array<int, 6> light_nums{ 1, 10, 100, 250, 500, 1000 };
+   constexpr int frame_num = 60;
+   const int original_light_num = Lights->getTotalLightNum();
+   const bool use_light_culling = UseLightCulling;
+   // The profiler's time-elapsed queries cannot nest in the ones timing the frames here.
+   const bool is_profiling = Profiler->isEnabled();
+   Profiler->setEnabled( false );
+   std::mt19937 generator(0);
+   std::uniform_real_distribution<float> position(0.0f, 30.0f);
+   std::uniform_real_distribution<float> color(0.0f, 1.0f);
+
+   GLuint query;
+   glCreateQueries( GL_TIME_ELAPSED, 1, &query );
+   std::cout << "Light Culling Benchmark (GPU time per frame)\n";
+   std::cout << std::setw( 8 ) << "Lights" << std::setw( 14 ) << "All Lights" << std::setw( 14 ) << "Clustered"
+      << std::setw( 16 ) << "Light Indices" << std::setw( 16 ) << "Index Capacity" << "\n";
+   for (const int light_num : light_nums) {
+      if (Lights->getTotalLightNum() > light_num) continue;
+
+      while (Lights->getTotalLightNum() < light_num) {
+         const glm::vec4 light_position(position( generator ), position( generator ), position( generator ), 1.0f);
+         const glm::vec4 diffuse_color(color( generator ), color( generator ), color( generator ), 1.0f);
+         Lights->addLight(
+            light_position, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f), diffuse_color, diffuse_color,
+            glm::vec3(0.0f, 0.0f, -1.0f), 180.0f, 0.0f, 0.5f
+         );
+      }
 
-      ScreenObject->updateTexture( Slide, 0 );
+      std::cout << std::setw( 8 ) << light_num;
+      for (const bool use_culling : { false, true }) {
+         UseLightCulling = use_culling;
+         // The new lights are uploaded outside of the timed frames. The second frame grows the index list
+         // to what the first one counted, and both wait for the frames before them to report their counts.
+         for (int i = 0; i < 2; ++i) {
+            glFinish();
+            render();
+         }
+         double elapsed_time_in_ms = 0.0;
+         for (int i = 0; i < frame_num; ++i) {
+            glBeginQuery( GL_TIME_ELAPSED, query );
+            render();
+            glEndQuery( GL_TIME_ELAPSED );
+            GLuint64 elapsed_time_in_ns = 0;
+            glGetQueryObjectui64v( query, GL_QUERY_RESULT, &elapsed_time_in_ns );
+            elapsed_time_in_ms += static_cast<double>(elapsed_time_in_ns) * 1e-6;
+         }
+         std::cout << std::setw( 11 ) << std::fixed << std::setprecision( 3 ) << elapsed_time_in_ms / frame_num << " ms";
+      }
+      std::cout << std::defaultfloat << std::setw( 16 ) << Lights->getLightIndexNum()
+         << std::setw( 16 ) << Lights->getLightIndexCapacity() << "\n";
    }
+   glDeleteQueries( 1, &query );
+
+   Lights->truncateLights( original_light_num );
+   UseLightCulling = use_light_culling;
+   Profiler->setEnabled( is_profiling );
 }
 
-void RendererGL::play()
+void RendererGL::moveCamerasAlongPath(float progress) const
+{
+   // The main camera swings around the corner of the room while rising and falling, and the projector sweeps
+   // across the walls, so the projected area and the light clusters change every frame.
+   const float angle = glm::two_pi<float>() * progress;
+   const glm::vec3 up(0.0f, 1.0f, 0.0f);
+   const float azimuth = glm::radians( 45.0f + 25.0f * std::sin( angle ) );
+   const float height = 50.0f + 15.0f * std::sin( 2.0f * angle );
+   MainCamera->placeCamera(
+      glm::vec3(110.0f * std::sin( azimuth ), height, 110.0f * std::cos( azimuth )),
+      glm::vec3(10.0f, 10.0f, 10.0f),
+      up
+   );
+   Projector->placeCamera(
+      glm::vec3(40.0f, 30.0f, 20.0f),
+      glm::vec3(8.0f + 6.0f * std::cos( angle ), 10.0f + 6.0f * std::sin( angle ), 8.0f - 6.0f * std::cos( angle )),
+      up
+   );
+}
+
+std::string RendererGL::getTimeStatistics(std::vector<double> times_in_ms)
 {
-   if (glfwWindowShouldClose( Window )) initialize();
+   if (times_in_ms.empty()) return "{}";
+
+   std::sort( times_in_ms.begin(), times_in_ms.end() );
+   const auto percentile = [&times_in_ms](double p)
+   {
+      const auto index = static_cast<size_t>(std::ceil( p * static_cast<double>(times_in_ms.size()) ));
+      return times_in_ms[std::clamp<size_t>( index, 1, times_in_ms.size() ) - 1];
+   };
+   double sum = 0.0;
+   for (const double time : times_in_ms) sum += time;
+
+   std::ostringstream statistics;
+   statistics << std::fixed << std::setprecision( 4 )
+      << "{ \"mean\": " << sum / static_cast<double>(times_in_ms.size())
+      << ", \"p50\": " << percentile( 0.5 )
+      << ", \"p95\": " << percentile( 0.95 )
+      << ", \"p99\": " << percentile( 0.99 )
+      << ", \"max\": " << times_in_ms.back() << " }";
+   return statistics.str();
+}
+
+bool RendererGL::benchmark(const std::string& report_path, bool use_generated_slide, bool use_legacy_upload)
+{
+   if (!hasContext() || (Settings.IsHeadless && OffscreenFramebuffer == 0)) return false;
 
+   UseGeneratedSlide = use_generated_slide;
+   // The legacy upload only knew BGR slides.
+   UseLegacyUpload = use_legacy_upload;
+   if (UseLegacyUpload) UsePlanarYUV = false;
+   if (UseGeneratedSlide) CurrentSlideType = VIDEO;
    setLights();
    setWallObject();
    setScreenObject();
    setProjectorPyramidObject();
-   ObjectShader->addUniformLocation( "WhichObject" );
-   ObjectShader->addUniformLocation( "ProjectorViewMatrix" );
-   ObjectShader->addUniformLocation( "ProjectorProjectionMatrix" );
-   ObjectShader->setUniformLocations( Lights->getTotalLightNum() );
+   ObjectShader->setUniformBlocks( PROJECTOR + 1 );
+   AreObjectBlocksDirty = true;
+
+   const bool is_decoding = isMovingSlide() && !UseGeneratedSlide;
+   if (is_decoding && (Decoder == nullptr || !Decoder->isOpened())) {
+      std::cout << "Cannot Open the Slide for the Benchmark...\n";
+      return false;
+   }
+   if (CurrentSlideType == LIVE) {
+      std::cout << "Cannot Benchmark a Live Slide; its frames are not deterministic...\n";
+      return false;
+   }
+
+   // Each frame advances the slide by one of its frames and is finished before the next one starts,
+   // so the timings do not depend on how far the CPU runs ahead of the GPU.
+   const int frame_num = Settings.FrameNum > 0 ? Settings.FrameNum : 300;
+   std::vector<double> frame_times, gpu_times, upload_times;
+   frame_times.reserve( frame_num );
+   gpu_times.reserve( frame_num );
+   upload_times.reserve( frame_num );
+   double generation_time_in_ms = 0.0;
+   int uploaded_frame_num = 0;
+   ScreenObject->resetUploadedByteNum();
+   GLuint query;
+   glCreateQueries( GL_TIME_ELAPSED, 1, &query );
+   for (int i = 0; i < frame_num; ++i) {
+      const auto frame_start_time = std::chrono::steady_clock::now();
+      moveCamerasAlongPath( static_cast<float>(i) / static_cast<float>(frame_num) );
+
+      const cv::Mat* slide = nullptr;
+      if (UseGeneratedSlide && i > 0) {
+         generateSlide( Slide, i );
+         generation_time_in_ms += std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - frame_start_time
+         ).count();
+         slide = &Slide;
+      }
+      else if (is_decoding) {
+         slide = Decoder->waitForFrame( Decoder->getFrameTime( i ) );
+      }
+      double upload_time_in_ms = 0.0;
+      if (slide != nullptr) {
+         const auto upload_start_time = std::chrono::steady_clock::now();
+         uploadSlide( *slide );
+         upload_time_in_ms = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - upload_start_time
+         ).count();
+         uploaded_frame_num++;
+         if (is_decoding) Decoder->releaseFrame();
+      }
 
-   while (!glfwWindowShouldClose( Window )) {
+      glBeginQuery( GL_TIME_ELAPSED, query );
       render();
-      setNextSlide();
+      glEndQuery( GL_TIME_ELAPSED );
+      if (Window != nullptr) {
+         glfwSwapBuffers( Window );
+         glfwPollEvents();
+      }
+      glFinish();
+
+      GLuint64 gpu_time_in_ns = 0;
+      glGetQueryObjectui64v( query, GL_QUERY_RESULT, &gpu_time_in_ns );
+      frame_times.emplace_back(
+         std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frame_start_time).count()
+      );
+      gpu_times.emplace_back( static_cast<double>(gpu_time_in_ns) * 1e-6 );
+      upload_times.emplace_back( upload_time_in_ms );
+   }
+   glDeleteQueries( 1, &query );
+
+   const double decode_time_in_ms = UseGeneratedSlide ?
+      generation_time_in_ms / std::max( frame_num - 1, 1 ) : is_decoding ? Decoder->getMeanDecodeTime() : 0.0;
+   const size_t upload_bytes_per_frame =
+      ScreenObject->getUploadedByteNum() / static_cast<size_t>(std::max( uploaded_frame_num, 1 ));
+   const char* slide_names[] = { "image", "video", "sequence", "live" };
+   std::ostringstream report;
+   report << "{\n"
+      << "  \"renderer\": \"" << glGetString( GL_RENDERER ) << "\",\n"
+      << "  \"headless\": " << (Settings.IsHeadless ? "true" : "false") << ",\n"
+      << "  \"width\": " << FrameWidth << ",\n"
+      << "  \"height\": " << FrameHeight << ",\n"
+      << "  \"frames\": " << frame_num << ",\n"
+      << "  \"slide\": \"" << (UseGeneratedSlide ? "generated" : slide_names[CurrentSlideType]) << "\",\n"
+      << "  \"lights\": " << Lights->getTotalLightNum() << ",\n"
+      << "  \"light_culling\": " << (UseLightCulling ? "true" : "false") << ",\n"
+      << "  \"frame_time_ms\": " << getTimeStatistics( frame_times ) << ",\n"
+      << "  \"gpu_time_ms\": " << getTimeStatistics( gpu_times ) << ",\n"
+      << "  \"upload\": \"" << (UseLegacyUpload ? "legacy" : "streaming") << "\",\n"
+      << "  \"upload_time_ms\": " << getTimeStatistics( upload_times ) << ",\n"
+      << "  \"upload_bytes_per_frame\": " << upload_bytes_per_frame << ",\n"
+      << "  \"decode_time_ms\": " << std::fixed << std::setprecision( 4 ) << decode_time_in_ms << "\n"
+      << "}\n";
+   std::cout << report.str();
+
+   if (Decoder != nullptr) Decoder->close();
+   ShaderWatcher->stop();
+   deleteOffscreenFramebuffer();
+   if (Window != nullptr) glfwDestroyWindow( Window );
+   if (report_path.empty()) return true;
+
+   std::ofstream file(report_path);
+   if (!file.is_open()) {
+      std::cout << "Cannot Write the Benchmark Report to " << report_path << "...\n";
+      return false;
+   }
+   file << report.str();
+   return true;
+}
 
-      glfwSwapBuffers( Window );
-      glfwPollEvents();
+void RendererGL::setNextSlide()
+{
+   const ProfilerGL::Scope scope( Profiler.get(), "setNextSlide", true );
+   if (isMovingSlide() && Decoder != nullptr) {
+      // When no new frame is due, the last one stays in the texture and nothing is uploaded.
+      const cv::Mat* frame = Decoder->acquireFrame( Clock->getTime() );
+      if (frame == nullptr) return;
+
+      uploadSlide( *frame );
+      Decoder->releaseFrame();
+   }
+}
+
+void RendererGL::generateSlide(cv::Mat& slide, int frame_index)
+{
+   // Color bars scroll over a checkerboard by a few pixels per frame, so every frame has to be uploaded.
+   slide.create( 720, 1280, CV_8UC3 );
+   for (int y = 0; y < slide.rows; ++y) {
+      auto* row = slide.ptr<cv::Vec3b>( y );
+      for (int x = 0; x < slide.cols; ++x) {
+         const int bar = ((x + frame_index * 4) / 160) % 8;
+         const auto level = static_cast<uchar>(((x / 40 + y / 40) % 2 == 0) ? 160 : 255);
+         row[x] = cv::Vec3b(bar & 1 ? level : 0, bar & 2 ? level : 0, bar & 4 ? level : 0);
+      }
+   }
+}
+
+void RendererGL::updateShaders() const
+{
+   if (ShaderWatcher->hasChanged()) {
+      std::cout << "Recompiling Shaders...\n";
+      ObjectShader->reloadShaders();
+      LightCullingShader->reloadShaders();
+   }
+
+   // The programs are swapped in between frames, so the previous ones keep drawing until the new ones are ready.
+   const bool is_object_shader_updated = ObjectShader->updatePendingPrograms();
+   const bool is_light_culling_shader_updated = LightCullingShader->updatePendingPrograms();
+   if (is_object_shader_updated || is_light_culling_shader_updated) std::cout << "Shaders Reloaded!\n";
+}
+
+void RendererGL::toggleRecording()
+{
+   if (Recorder->isRecording()) {
+      Recorder->stop();
+      Recorder->printStatistics();
+      std::cout << "Recording Stopped!\n";
+      return;
+   }
+
+   // The window is not paced by the slide, so frames are written at the nominal display rate,
+   // and a frame is dropped rather than stalling the window when the encoder falls behind.
+   int width, height;
+   glfwGetFramebufferSize( Window, &width, &height );
+   const std::string output_path =
+      Settings.OutputPath.empty() ? std::string(CMAKE_BINARY_DIR) + "/recording.mp4" : Settings.OutputPath;
+   if (Recorder->start( output_path, width, height, Settings.FPS > 0.0 ? Settings.FPS : 60.0, true )) {
+      std::cout << "Recording to " << output_path << "!\n";
+   }
+}
+
+void RendererGL::toggleProfiler() const
+{
+   if (!Profiler->isEnabled()) {
+      Profiler->setEnabled( true );
+      std::cout << "Profiler On!\n";
+      return;
+   }
+
+   Profiler->setEnabled( false );
+   Profiler->printStatistics();
+   const std::string profile_path = std::string(CMAKE_BINARY_DIR) + "/profile";
+   if (Profiler->exportChromeTrace( profile_path + ".json" ) && Profiler->exportCSV( profile_path + ".csv" )) {
+      std::cout << "Profiler Off! The frames are exported to " << profile_path << ".json and .csv\n";
+   }
+}
+
+void RendererGL::playOffscreen()
+{
+   if (OffscreenFramebuffer == 0) return;
+
+   // Without a frame count, a moving slide is rendered once to its end, so it must not loop.
+   const bool is_moving_slide = isMovingSlide() && Decoder != nullptr && Decoder->isOpened();
+   int frame_num = Settings.FrameNum;
+   if (frame_num == 0) {
+      if (!is_moving_slide) frame_num = 1;
+      else if (CurrentSlideType == LIVE) {
+         std::cout << "Cannot Render a Live Slide Offscreen without --frames...\n";
+         return;
+      }
+      else Decoder->setLooping( false );
+   }
+
+   // Every frame has to be in the output, so the recorder waits for the encoder instead of dropping frames.
+   const std::string output_path =
+      Settings.OutputPath.empty() ? std::string(CMAKE_BINARY_DIR) + "/frames" : Settings.OutputPath;
+   const double fps = Settings.FPS > 0.0 ? Settings.FPS : is_moving_slide ? Decoder->getFPS() : 30.0;
+   if (!Recorder->start( output_path, FrameWidth, FrameHeight, fps, false )) return;
+
+   // The frames are stepped on a fixed timeline instead of the wall clock, so every output frame shows
+   // the slide frame which is due at its time however long it takes to render.
+   // The live slide has no timeline of its own, so it takes the newest published frame.
+   const double first_frame_time = is_moving_slide ? Decoder->getFirstFrameTime() : 0.0;
+   int rendered_frame_num = 0;
+   const auto start_time = std::chrono::steady_clock::now();
+   while (frame_num == 0 || rendered_frame_num < frame_num) {
+      if (CurrentSlideType == LIVE) setNextSlide();
+      else if (is_moving_slide) {
+         const double time = first_frame_time + static_cast<double>(rendered_frame_num) * 1000.0 / fps;
+         const cv::Mat* slide = Decoder->waitForFrame( time );
+         if (slide != nullptr) {
+            uploadSlide( *slide );
+            Decoder->releaseFrame();
+         }
+         else if (frame_num == 0 && Decoder->hasReachedEnd()) break;
+      }
+      render();
+      Recorder->capture();
+      rendered_frame_num++;
+   }
+
+   Recorder->stop();
+
+   const double elapsed_time_in_sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+   std::cout << "Rendered " << rendered_frame_num << " Frames to " << output_path << " ("
+      << (elapsed_time_in_sec > 0.0 ? rendered_frame_num / elapsed_time_in_sec : 0.0) << " fps)\n";
+   Recorder->printStatistics();
+}
+
+void RendererGL::play()
+{
+   if (!hasContext()) return;
+   if (Window != nullptr && glfwWindowShouldClose( Window )) initialize();
+
+   setLights();
+   setWallObject();
+   setScreenObject();
+   setProjectorPyramidObject();
+   ObjectShader->setUniformBlocks( PROJECTOR + 1 );
+   AreObjectBlocksDirty = true;
+
+   if (Settings.IsHeadless) playOffscreen();
+   else {
+      while (!glfwWindowShouldClose( Window )) {
+         {
+            const ProfilerGL::Scope frame_scope( Profiler.get(), "Frame" );
+            updateShaders();
+            render();
+            Recorder->capture(); // reads the back buffer before it is swapped
+            setNextSlide();
+
+            const ProfilerGL::Scope swap_scope( Profiler.get(), "glfwSwapBuffers" );
+            glfwSwapBuffers( Window );
+         }
+         Profiler->endFrame();
+         glfwPollEvents();
+      }
    }
-   glfwDestroyWindow( Window );
-}
\ No newline at end of file
+   if (Decoder != nullptr) {
+      if (isMovingSlide()) Decoder->printStatistics();
+      Decoder->close();
+   }
+   if (Recorder->isRecording()) {
+      Recorder->stop();
+      Recorder->printStatistics();
+   }
+   ShaderWatcher->stop();
+   deleteOffscreenFramebuffer();
+   if (Window != nullptr) glfwDestroyWindow( Window );
+}
@@ -1,12 +1,19 @@
 #include "Shader.h"
 
-ShaderGL::ShaderGL() : ShaderProgram( 0 )
+static_assert( sizeof(ShaderGL::FrameUniformBlock) == 256, "FrameUniformBlock must match the std140 layout" );
+static_assert( sizeof(ShaderGL::ObjectUniformBlock) == 352, "ObjectUniformBlock must match the std140 layout" );
+
+ShaderGL::ShaderGL() : ShaderProgram( 0 ), UniformBlockBuffer( 0 ), ObjectBlockOffset( 0 ), ObjectBlockStride( 0 )
 {
 }
 
 ShaderGL::~ShaderGL()
 {
+   if (UniformBlockBuffer != 0) glDeleteBuffers( 1, &UniformBlockBuffer );
    if (ShaderProgram != 0) glDeleteProgram( ShaderProgram );
+   for (const auto& program : ComputeShaderPrograms) glDeleteProgram( program );
+   for (const auto& permutation : PermutationPrograms) glDeleteProgram( permutation.second );
+   for (auto& pending : PendingPrograms) discardProgram( pending );
 }
 
 void ShaderGL::readShaderFile(std::string& shader_contents, const char* shader_path)
@@ -31,6 +38,9 @@ std::string ShaderGL::getShaderTypeString(GLenum shader_type)
       case GL_VERTEX_SHADER: return "Vertex Shader";
       case GL_FRAGMENT_SHADER: return "Fragment Shader";
       case GL_GEOMETRY_SHADER: return "Geometry Shader";
+      case GL_TESS_CONTROL_SHADER: return "Tessellation Control Shader";
+      case GL_TESS_EVALUATION_SHADER: return "Tessellation Evaluation Shader";
+      case GL_COMPUTE_SHADER: return "Compute Shader";
       default: return "";
    }
 }
@@ -45,31 +55,352 @@ bool ShaderGL::checkCompileError(GLenum shader_type, GLuint shader)
       glGetShaderiv( shader, GL_INFO_LOG_LENGTH, &max_length );
 
       std::cerr << " ======= " << getShaderTypeString( shader_type ) << " log ======= \n";
-      std::vector<GLchar> error_log(max_length);
+      std::vector<GLchar> error_log(std::max( max_length, 1 ));
       glGetShaderInfoLog( shader, max_length, &max_length, &error_log[0] );
       for (const auto& c : error_log) std::cerr << c;
       std::cerr << "\n";
-      glDeleteShader( shader );
    }
    return compiled == GL_TRUE;
 }
 
-GLuint ShaderGL::getCompiledShader(GLenum shader_type, const char* shader_path)
+bool ShaderGL::checkLinkError(GLuint program)
 {
-   if (shader_path == nullptr) return 0;
+   GLint linked = 0;
+   glGetProgramiv( program, GL_LINK_STATUS, &linked );
+
+   if (linked == GL_FALSE) {
+      GLint max_length = 0;
+      glGetProgramiv( program, GL_INFO_LOG_LENGTH, &max_length );
+
+      std::cerr << " ======= Program log ======= \n";
+      std::vector<GLchar> error_log(std::max( max_length, 1 ));
+      glGetProgramInfoLog( program, max_length, &max_length, &error_log[0] );
+      for (const auto& c : error_log) std::cerr << c;
+      std::cerr << "\n";
+   }
+   return linked == GL_TRUE;
+}
 
+std::string ShaderGL::getShaderSource(const char* shader_path, const std::string& defines)
+{
    std::string shader_contents;
    readShaderFile( shader_contents, shader_path );
+   if (!defines.empty()) {
+      // The version directive has to stay the first statement.
+      const size_t version_position = shader_contents.find( "#version" );
+      const size_t line_end = version_position == std::string::npos ?
+         std::string::npos : shader_contents.find( '\n', version_position );
+      shader_contents.insert( line_end == std::string::npos ? 0 : line_end + 1, defines );
+   }
+   return shader_contents;
+}
+
+void ShaderGL::initializeParallelCompilation(GLADloadproc get_proc_address)
+{
+   // glad is not generated with the extension, so its entry point is loaded here.
+   // The ARB version shares the token and the semantics.
+   bool has_khr_extension = false;
+   bool has_arb_extension = false;
+   GLint extension_num = 0;
+   glGetIntegerv( GL_NUM_EXTENSIONS, &extension_num );
+   for (GLint i = 0; i < extension_num; ++i) {
+      const std::string extension = reinterpret_cast<const char*>(glGetStringi( GL_EXTENSIONS, i ));
+      if (extension == "GL_KHR_parallel_shader_compile") has_khr_extension = true;
+      else if (extension == "GL_ARB_parallel_shader_compile") has_arb_extension = true;
+   }
+
+   using MaxShaderCompilerThreads = void (APIENTRYP)(GLuint count);
+   MaxShaderCompilerThreads set_max_shader_compiler_threads = nullptr;
+   if (has_khr_extension) {
+      set_max_shader_compiler_threads = reinterpret_cast<MaxShaderCompilerThreads>(
+         get_proc_address( "glMaxShaderCompilerThreadsKHR" )
+      );
+   }
+   else if (has_arb_extension) {
+      set_max_shader_compiler_threads = reinterpret_cast<MaxShaderCompilerThreads>(
+         get_proc_address( "glMaxShaderCompilerThreadsARB" )
+      );
+   }
+
+   SupportsParallelCompilation = set_max_shader_compiler_threads != nullptr;
+   if (SupportsParallelCompilation) set_max_shader_compiler_threads( 0xFFFFFFFF ); // as many as the driver likes
+   else std::cout << "The driver cannot compile shaders in parallel; shader reloads block the rendering...\n";
+}
 
-   const GLuint shader = glCreateShader( shader_type );
-   const char* shader_source = shader_contents.c_str();
-   glShaderSource( shader, 1, &shader_source, nullptr );
-   glCompileShader( shader );
-   if (!checkCompileError( shader_type, shader )) {
-      std::cerr << "Could not compile shader\n";
+bool ShaderGL::isProgramCacheUsable()
+{
+   GLint binary_format_num = 0;
+   glGetIntegerv( GL_NUM_PROGRAM_BINARY_FORMATS, &binary_format_num );
+   return !ProgramCacheDirectory.empty() && binary_format_num > 0;
+}
+
+uint64_t ShaderGL::getSourceHash(const std::vector<StageSource>& stages)
+{
+   // 64-bit FNV-1a over the driver identity and every stage, so a driver update or an edited source misses the cache.
+   uint64_t source_hash = 14695981039346656037ull;
+   const auto hash = [&source_hash](const void* data, size_t size)
+   {
+      const auto* bytes = static_cast<const uint8_t*>(data);
+      for (size_t i = 0; i < size; ++i) {
+         source_hash ^= bytes[i];
+         source_hash *= 1099511628211ull;
+      }
+   };
+   for (const GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION }) {
+      const auto* identity = reinterpret_cast<const char*>(glGetString( name ));
+      if (identity != nullptr) hash( identity, std::strlen( identity ) + 1 );
+   }
+   for (const auto& stage : stages) {
+      hash( &stage.Type, sizeof(stage.Type) );
+      hash( stage.Source.data(), stage.Source.size() + 1 );
+   }
+   return source_hash;
+}
+
+std::string ShaderGL::getProgramCachePath(const ProgramRecipe& recipe)
+{
+   // The shader file names tell the shaders apart, and the type and the key tell the programs of a shader apart.
+   std::ostringstream path;
+   path << ProgramCacheDirectory << "/";
+   for (const auto& shader_path : recipe.ShaderPaths) {
+      path << std::filesystem::path(shader_path.second).stem().string() << "_";
+   }
+   path << recipe.Type << "_" << std::hex << std::setw( 8 ) << std::setfill( '0' ) << recipe.Key << ".bin";
+   return path.str();
+}
+
+GLuint ShaderGL::loadCachedProgram(const std::string& cache_path, uint64_t source_hash)
+{
+   std::ifstream file( cache_path, std::ios::in | std::ios::binary );
+   if (!file.is_open()) return 0;
+
+   ProgramCacheHeader header{};
+   file.read( reinterpret_cast<char*>(&header), sizeof(header) );
+   if (!file || header.SourceHash != source_hash || header.BinaryLength <= 0) return 0;
+
+   std::vector<char> binary(header.BinaryLength);
+   file.read( binary.data(), header.BinaryLength );
+   if (!file) return 0;
+
+   // The driver may reject a binary of another build even with the same version string, then it is recompiled.
+   const GLuint program = glCreateProgram();
+   glProgramBinary( program, header.BinaryFormat, binary.data(), header.BinaryLength );
+   GLint linked = 0;
+   glGetProgramiv( program, GL_LINK_STATUS, &linked );
+   if (linked == GL_FALSE) {
+      glDeleteProgram( program );
       return 0;
    }
-   return shader;
+   return program;
+}
+
+void ShaderGL::saveProgramToCache(const std::string& cache_path, uint64_t source_hash, GLuint program)
+{
+   GLint binary_length = 0;
+   glGetProgramiv( program, GL_PROGRAM_BINARY_LENGTH, &binary_length );
+   if (binary_length <= 0) return;
+
+   ProgramCacheHeader header{};
+   header.SourceHash = source_hash;
+   std::vector<char> binary(binary_length);
+   glGetProgramBinary( program, binary_length, &header.BinaryLength, &header.BinaryFormat, binary.data() );
+   if (header.BinaryLength <= 0) return;
+
+   std::error_code error;
+   std::filesystem::create_directories( ProgramCacheDirectory, error );
+   // The binary is written aside and renamed over the stale one, so a run which stops halfway never leaves
+   // a truncated binary behind.
+   const std::string temporary_path = cache_path + ".tmp";
+   {
+      std::ofstream file( temporary_path, std::ios::out | std::ios::binary | std::ios::trunc );
+      if (!file.is_open()) {
+         std::cout << "Cannot write the shader program cache: " << cache_path << "\n";
+         return;
+      }
+      file.write( reinterpret_cast<const char*>(&header), sizeof(header) );
+      file.write( binary.data(), header.BinaryLength );
+      if (!file.good()) {
+         file.close();
+         std::filesystem::remove( temporary_path, error );
+         std::cout << "Cannot write the shader program cache: " << cache_path << "\n";
+         return;
+      }
+   }
+   std::filesystem::rename( temporary_path, cache_path, error );
+   if (error) {
+      std::filesystem::remove( temporary_path, error );
+      std::cout << "Cannot write the shader program cache: " << cache_path << "\n";
+   }
+}
+
+ShaderGL::PendingProgram ShaderGL::submitProgram(const ProgramRecipe& recipe)
+{
+   PendingProgram pending{};
+   pending.Type = recipe.Type;
+   pending.Key = recipe.Key;
+   pending.SubmittedTime = std::chrono::steady_clock::now();
+
+   std::vector<StageSource> stages;
+   for (const auto& shader_path : recipe.ShaderPaths) {
+      stages.push_back( { shader_path.first, getShaderSource( shader_path.second.c_str(), recipe.Defines ) } );
+   }
+
+   const bool use_cache = isProgramCacheUsable();
+   if (use_cache) {
+      pending.CachePath = getProgramCachePath( recipe );
+      pending.SourceHash = getSourceHash( stages );
+      pending.Program = loadCachedProgram( pending.CachePath, pending.SourceHash );
+      pending.IsLoadedFromCache = pending.Program != 0;
+      if (pending.IsLoadedFromCache) return pending;
+   }
+
+   // The compile and link status are not queried here, since the query waits for the driver.
+   pending.Program = glCreateProgram();
+   if (use_cache) glProgramParameteri( pending.Program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE );
+   for (const auto& stage : stages) {
+      const GLuint shader = glCreateShader( stage.Type );
+      const char* source = stage.Source.c_str();
+      glShaderSource( shader, 1, &source, nullptr );
+      glCompileShader( shader );
+      glAttachShader( pending.Program, shader );
+      pending.Shaders.emplace_back( stage.Type, shader );
+   }
+   glLinkProgram( pending.Program );
+   return pending;
+}
+
+bool ShaderGL::isProgramComplete(const PendingProgram& pending)
+{
+   constexpr GLenum completion_status = 0x91B1; // GL_COMPLETION_STATUS_KHR
+   if (pending.IsLoadedFromCache || !SupportsParallelCompilation) return true;
+
+   GLint completed = GL_FALSE;
+   glGetProgramiv( pending.Program, completion_status, &completed );
+   return completed == GL_TRUE;
+}
+
+bool ShaderGL::finishProgram(PendingProgram& pending)
+{
+   const auto get_elapsed_time_in_ms = [&pending]()
+   {
+      return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - pending.SubmittedTime).count();
+   };
+
+   if (pending.IsLoadedFromCache) {
+      ProgramCache.HitNum++;
+      ProgramCache.HitTimeInMs += get_elapsed_time_in_ms();
+      return true;
+   }
+
+   bool is_compiled = true;
+   for (const auto& shader : pending.Shaders) {
+      is_compiled = checkCompileError( shader.first, shader.second ) && is_compiled;
+      glDetachShader( pending.Program, shader.second );
+      glDeleteShader( shader.second );
+   }
+   pending.Shaders.clear();
+   if (!is_compiled) std::cerr << "Could not compile shader\n";
+
+   const bool is_linked = is_compiled && checkLinkError( pending.Program );
+   if (is_linked && isProgramCacheUsable()) saveProgramToCache( pending.CachePath, pending.SourceHash, pending.Program );
+
+   ProgramCache.MissNum++;
+   ProgramCache.MissTimeInMs += get_elapsed_time_in_ms();
+   return is_linked;
+}
+
+void ShaderGL::discardProgram(PendingProgram& pending)
+{
+   for (const auto& shader : pending.Shaders) glDeleteShader( shader.second );
+   pending.Shaders.clear();
+   glDeleteProgram( pending.Program );
+   pending.Program = 0;
+}
+
+GLuint& ShaderGL::getProgramSlot(ProgramType type, uint32_t key)
+{
+   if (type == PERMUTATION_PROGRAM) return PermutationPrograms[key];
+   if (type == COMPUTE_PROGRAM) return ComputeShaderPrograms[key];
+   return ShaderProgram;
+}
+
+void ShaderGL::installProgram(PendingProgram& pending, bool is_linked)
+{
+   // A program which failed to link is only installed when there is nothing to fall back to.
+   GLuint& slot = getProgramSlot( pending.Type, pending.Key );
+   if (is_linked || slot == 0) {
+      if (slot != 0) glDeleteProgram( slot );
+      slot = pending.Program;
+   }
+   else {
+      std::cout << "Cannot replace a shader program; the previous one is kept...\n";
+      glDeleteProgram( pending.Program );
+   }
+   pending.Program = 0;
+}
+
+void ShaderGL::setProgramRecipes(ProgramType type, std::vector<ProgramRecipe>&& recipes)
+{
+   for (auto& pending : PendingPrograms) {
+      if (pending.Type == type) discardProgram( pending );
+   }
+   PendingPrograms.erase(
+      std::remove_if(
+         PendingPrograms.begin(), PendingPrograms.end(),
+         [type](const PendingProgram& pending) { return pending.Type == type; }
+      ),
+      PendingPrograms.end()
+   );
+   ProgramRecipes.erase(
+      std::remove_if(
+         ProgramRecipes.begin(), ProgramRecipes.end(),
+         [type](const ProgramRecipe& recipe) { return recipe.Type == type; }
+      ),
+      ProgramRecipes.end()
+   );
+
+   for (auto& recipe : recipes) {
+      PendingPrograms.emplace_back( submitProgram( recipe ) );
+      ProgramRecipes.emplace_back( std::move( recipe ) );
+   }
+}
+
+void ShaderGL::waitForPendingPrograms()
+{
+   // The programs were submitted together, so the driver has been compiling all of them while the first is awaited.
+   for (auto& pending : PendingPrograms) installProgram( pending, finishProgram( pending ) );
+   PendingPrograms.clear();
+}
+
+void ShaderGL::reloadShaders()
+{
+   for (auto& pending : PendingPrograms) discardProgram( pending );
+   PendingPrograms.clear();
+   for (const auto& recipe : ProgramRecipes) PendingPrograms.emplace_back( submitProgram( recipe ) );
+}
+
+bool ShaderGL::updatePendingPrograms()
+{
+   if (PendingPrograms.empty()) return false;
+
+   // Without the parallel compilation every program counts as complete, so this blocks as the initial build does.
+   for (const auto& pending : PendingPrograms) {
+      if (!isProgramComplete( pending )) return false;
+   }
+   waitForPendingPrograms();
+   return true;
+}
+
+void ShaderGL::printProgramCacheStatistics()
+{
+   if (ProgramCacheDirectory.empty()) return;
+
+   const auto get_average = [](double time, int num) { return num > 0 ? time / num : 0.0; };
+   std::cout << "Shader Program Cache (" << ProgramCacheDirectory << ")\n";
+   std::cout << " - Hits: " << ProgramCache.HitNum << " (" << std::fixed << std::setprecision( 2 )
+      << get_average( ProgramCache.HitTimeInMs, ProgramCache.HitNum ) << " ms per program)\n";
+   std::cout << " - Misses: " << ProgramCache.MissNum << " ("
+      << get_average( ProgramCache.MissTimeInMs, ProgramCache.MissNum ) << " ms per program)\n" << std::defaultfloat;
 }
 
 void ShaderGL::setShader(
@@ -80,100 +411,129 @@ void ShaderGL::setShader(
    const char* tessellation_evaluation_shader_path
 )
 {
-   const GLuint vertex_shader = getCompiledShader( GL_VERTEX_SHADER, vertex_shader_path );
-   const GLuint fragment_shader = getCompiledShader( GL_FRAGMENT_SHADER, fragment_shader_path );
-   const GLuint geometry_shader = getCompiledShader( GL_GEOMETRY_SHADER, geometry_shader_path );
-   const GLuint tessellation_control_shader = getCompiledShader( GL_TESS_CONTROL_SHADER, tessellation_control_shader_path );
-   const GLuint tessellation_evaluation_shader = getCompiledShader( GL_TESS_EVALUATION_SHADER, tessellation_evaluation_shader_path );
-   ShaderProgram = glCreateProgram();
-   glAttachShader( ShaderProgram, vertex_shader );
-   glAttachShader( ShaderProgram, fragment_shader );
-   if (geometry_shader != 0) glAttachShader( ShaderProgram, geometry_shader );
-   if (tessellation_control_shader != 0) glAttachShader( ShaderProgram, tessellation_control_shader );
-   if (tessellation_evaluation_shader != 0) glAttachShader( ShaderProgram, tessellation_evaluation_shader );
-   glLinkProgram( ShaderProgram );
-   glDeleteShader( vertex_shader );
-   glDeleteShader( fragment_shader );
-   if (geometry_shader != 0) glDeleteShader( geometry_shader );
-   if (tessellation_control_shader != 0) glDeleteShader( tessellation_control_shader );
-   if (tessellation_evaluation_shader != 0) glDeleteShader( tessellation_evaluation_shader );
+   ProgramRecipe recipe{ BASIC_PROGRAM, 0, {}, std::string() };
+   const std::array<std::pair<GLenum, const char*>, 5> shader_paths{
+      std::make_pair( GL_VERTEX_SHADER, vertex_shader_path ),
+      std::make_pair( GL_FRAGMENT_SHADER, fragment_shader_path ),
+      std::make_pair( GL_GEOMETRY_SHADER, geometry_shader_path ),
+      std::make_pair( GL_TESS_CONTROL_SHADER, tessellation_control_shader_path ),
+      std::make_pair( GL_TESS_EVALUATION_SHADER, tessellation_evaluation_shader_path )
+   };
+   for (const auto& shader_path : shader_paths) {
+      if (shader_path.second != nullptr) recipe.ShaderPaths.emplace_back( shader_path.first, shader_path.second );
+   }
+
+   std::vector<ProgramRecipe> recipes;
+   recipes.emplace_back( std::move( recipe ) );
+   setProgramRecipes( BASIC_PROGRAM, std::move( recipes ) );
 }
 
-void ShaderGL::setComputeShaders(const std::vector<const char*>& compute_shader_paths)
+void ShaderGL::setShaderPermutations(
+   const char* vertex_shader_path,
+   const char* fragment_shader_path,
+   const std::vector<std::string>& feature_defines,
+   const std::vector<uint32_t>& permutation_keys
+)
 {
-   ComputeShaderPrograms.clear();
-   ComputeShaderPrograms.resize( compute_shader_paths.size() );
-   for (size_t i = 0; i < ComputeShaderPrograms.size(); ++i) {
-      const GLuint compute_shader = getCompiledShader( GL_COMPUTE_SHADER, compute_shader_paths[i] );
-      ComputeShaderPrograms[i] = glCreateProgram();
-      glAttachShader( ComputeShaderPrograms[i], compute_shader );
-      glLinkProgram( ComputeShaderPrograms[i] );
-      glDeleteShader( compute_shader );
+   std::vector<ProgramRecipe> recipes;
+   for (const auto& key : permutation_keys) {
+      std::string defines;
+      for (size_t i = 0; i < feature_defines.size(); ++i) {
+         if (key & (1u << i)) defines += "#define " + feature_defines[i] + "\n";
+      }
+      recipes.push_back(
+         {
+            PERMUTATION_PROGRAM, key,
+            { { GL_VERTEX_SHADER, vertex_shader_path }, { GL_FRAGMENT_SHADER, fragment_shader_path } },
+            defines
+         }
+      );
    }
+   setProgramRecipes( PERMUTATION_PROGRAM, std::move( recipes ) );
 }
 
-void ShaderGL::setBasicTransformationUniforms()
+GLuint ShaderGL::getShaderProgram(uint32_t permutation_key) const
 {
-   Location.World = glGetUniformLocation( ShaderProgram, "WorldMatrix" );
-   Location.View = glGetUniformLocation( ShaderProgram, "ViewMatrix" );
-   Location.Projection = glGetUniformLocation( ShaderProgram, "ProjectionMatrix" );
-   Location.ModelViewProjection = glGetUniformLocation( ShaderProgram, "ModelViewProjectionMatrix" );
+   const auto it = PermutationPrograms.find( permutation_key );
+   if (it == PermutationPrograms.end()) {
+      std::cout << "Cannot find the shader permutation: " << permutation_key << "\n";
+      return 0;
+   }
+   return it->second;
 }
 
-void ShaderGL::setUniformLocations(int light_num)
+void ShaderGL::setComputeShaders(
+   const std::vector<const char*>& compute_shader_paths,
+   const std::vector<std::string>& shader_defines
+)
 {
-   setBasicTransformationUniforms();
-
-   Location.MaterialEmission = glGetUniformLocation( ShaderProgram, "Material.EmissionColor" );
-   Location.MaterialAmbient = glGetUniformLocation( ShaderProgram, "Material.AmbientColor" );
-   Location.MaterialDiffuse = glGetUniformLocation( ShaderProgram, "Material.DiffuseColor" );
-   Location.MaterialSpecular = glGetUniformLocation( ShaderProgram, "Material.SpecularColor" );
-   Location.MaterialSpecularExponent = glGetUniformLocation( ShaderProgram, "Material.SpecularExponent" );
-
-   Location.Texture[0] = glGetUniformLocation( ShaderProgram, "BaseTexture" );
-   Location.Texture[1] = glGetUniformLocation( ShaderProgram, "NormalMap" );
-   Location.UseTexture = glGetUniformLocation( ShaderProgram, "UseTexture" );
-
-   Location.UseLight = glGetUniformLocation( ShaderProgram, "UseLight" );
-   Location.LightNum = glGetUniformLocation( ShaderProgram, "LightNum" );
-   Location.GlobalAmbient = glGetUniformLocation( ShaderProgram, "GlobalAmbient" );
-
-   Location.Lights.resize( light_num );
-   for (int i = 0; i < light_num; ++i) {
-      Location.Lights[i].LightSwitch = glGetUniformLocation( ShaderProgram, std::string("Lights[" + std::to_string( i ) + "].LightSwitch").c_str() );
-      Location.Lights[i].LightPosition = glGetUniformLocation( ShaderProgram, std::string("Lights[" + std::to_string( i ) + "].Position").c_str() );
-      Location.Lights[i].LightAmbient = glGetUniformLocation( ShaderProgram, std::string("Lights[" + std::to_string( i ) + "].AmbientColor").c_str() );
-      Location.Lights[i].LightDiffuse = glGetUniformLocation( ShaderProgram, std::string("Lights[" + std::to_string( i ) + "].DiffuseColor").c_str() );
-      Location.Lights[i].LightSpecular = glGetUniformLocation( ShaderProgram, std::string("Lights[" + std::to_string( i ) + "].SpecularColor").c_str() );
-      Location.Lights[i].SpotlightDirection = glGetUniformLocation( ShaderProgram, std::string("Lights[" + std::to_string( i ) + "].SpotlightDirection").c_str() );
-      Location.Lights[i].SpotlightCutoffAngle = glGetUniformLocation( ShaderProgram, std::string("Lights[" + std::to_string( i ) + "].SpotlightCutoffAngle").c_str() );
-      Location.Lights[i].SpotlightFeather = glGetUniformLocation( ShaderProgram, std::string("Lights[" + std::to_string( i ) + "].SpotlightFeather").c_str() );
-      Location.Lights[i].LightFallOffRadius = glGetUniformLocation( ShaderProgram, std::string("Lights[" + std::to_string( i ) + "].FallOffRadius").c_str() );
+   std::vector<ProgramRecipe> recipes;
+   for (size_t i = 0; i < compute_shader_paths.size(); ++i) {
+      std::string defines;
+      if (i < shader_defines.size() && !shader_defines[i].empty()) defines = "#define " + shader_defines[i] + "\n";
+      recipes.push_back(
+         { COMPUTE_PROGRAM, static_cast<uint32_t>(i), { { GL_COMPUTE_SHADER, compute_shader_paths[i] } }, defines }
+      );
    }
+   for (const auto& program : ComputeShaderPrograms) glDeleteProgram( program );
+   ComputeShaderPrograms.assign( compute_shader_paths.size(), 0 );
+   setProgramRecipes( COMPUTE_PROGRAM, std::move( recipes ) );
 }
 
-void ShaderGL::addUniformLocation(const std::string& name)
+void ShaderGL::setUniformBlocks(int object_num)
 {
-   CustomLocations[name] = glGetUniformLocation( ShaderProgram, name.c_str() );
+   // Each object block has to start at a multiple of the uniform buffer offset alignment to be bound as a range.
+   GLint alignment = 256;
+   glGetIntegerv( GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment );
+   const auto align = [alignment](GLsizeiptr size) { return (size + alignment - 1) / alignment * alignment; };
+   ObjectBlockOffset = align( sizeof(FrameUniformBlock) );
+   ObjectBlockStride = align( sizeof(ObjectUniformBlock) );
+   UniformBlockData.assign( ObjectBlockOffset + ObjectBlockStride * object_num, 0 );
+
+   if (UniformBlockBuffer != 0) glDeleteBuffers( 1, &UniformBlockBuffer );
+   glCreateBuffers( 1, &UniformBlockBuffer );
+   glNamedBufferStorage(
+      UniformBlockBuffer, static_cast<GLsizeiptr>(UniformBlockData.size()), nullptr, GL_DYNAMIC_STORAGE_BIT
+   );
+   glBindBufferRange( GL_UNIFORM_BUFFER, FRAME_BLOCK, UniformBlockBuffer, 0, sizeof(FrameUniformBlock) );
 }
 
-void ShaderGL::addUniformLocationToComputeShader(const std::string& name, int shader_index)
+void ShaderGL::updateFrameUniformBlock(const FrameUniformBlock& frame)
 {
-   CustomLocations[name] = glGetUniformLocation( ComputeShaderPrograms[shader_index], name.c_str() );
+   glNamedBufferSubData( UniformBlockBuffer, 0, sizeof(FrameUniformBlock), &frame );
 }
 
-void ShaderGL::transferBasicTransformationUniforms(const glm::mat4& to_world, const CameraGL* camera, bool use_texture) const
+void ShaderGL::updateObjectUniformBlocks(const ObjectUniformBlock* objects, int object_num)
 {
-   const glm::mat4 view = camera->getViewMatrix();
-   const glm::mat4 projection = camera->getProjectionMatrix();
-   const glm::mat4 model_view_projection = projection * view * to_world;
-   glUniformMatrix4fv( Location.World, 1, GL_FALSE, &to_world[0][0] );
-   glUniformMatrix4fv( Location.View, 1, GL_FALSE, &view[0][0] );
-   glUniformMatrix4fv( Location.Projection, 1, GL_FALSE, &projection[0][0] );
-   glUniformMatrix4fv( Location.ModelViewProjection, 1, GL_FALSE, &model_view_projection[0][0] );
+   assert( ObjectBlockOffset + ObjectBlockStride * object_num <= static_cast<GLsizeiptr>(UniformBlockData.size()) );
 
-   for (const auto& texture : Location.Texture) {
-      glUniform1i( texture.second, texture.first );
+   for (int i = 0; i < object_num; ++i) {
+      std::memcpy(
+         UniformBlockData.data() + ObjectBlockOffset + ObjectBlockStride * i, &objects[i], sizeof(ObjectUniformBlock)
+      );
    }
-   glUniform1i( Location.UseTexture, use_texture ? 1 : 0 );
-}
\ No newline at end of file
+   glNamedBufferSubData(
+      UniformBlockBuffer, ObjectBlockOffset, ObjectBlockStride * object_num, UniformBlockData.data() + ObjectBlockOffset
+   );
+}
+
+void ShaderGL::bindObjectUniformBlock(int object_index) const
+{
+   glBindBufferRange(
+      GL_UNIFORM_BUFFER, OBJECT_BLOCK, UniformBlockBuffer,
+      ObjectBlockOffset + ObjectBlockStride * object_index, sizeof(ObjectUniformBlock)
+   );
+}
+
+void ShaderGL::getBasicTransformationBlock(
+   ObjectUniformBlock& block,
+   const glm::mat4& to_world,
+   const CameraGL* camera,
+   bool use_texture
+)
+{
+   block.ModelViewMatrix = camera->getViewMatrix() * to_world;
+   block.ModelViewProjectionMatrix = camera->getViewProjectionMatrix() * to_world;
+   block.NormalMatrix = glm::transpose( glm::inverse( block.ModelViewMatrix ) );
+   block.UseTexture = use_texture ? 1 : 0;
+}
@@ -0,0 +1,67 @@
+#include "ShaderFileWatcher.h"
+
+ShaderFileWatcher::ShaderFileWatcher() : StopWatching( false ), IsChanged( false )
+{
+}
+
+ShaderFileWatcher::~ShaderFileWatcher()
+{
+   stop();
+}
+
+void ShaderFileWatcher::start(const std::string& directory_path, int interval_in_ms)
+{
+   stop();
+
+   StopWatching = false;
+   IsChanged.store( false, std::memory_order_relaxed );
+   Watcher = std::thread(
+      &ShaderFileWatcher::watch, this, directory_path, std::chrono::milliseconds(std::max( interval_in_ms, 1 ))
+   );
+}
+
+void ShaderFileWatcher::stop()
+{
+   if (!Watcher.joinable()) return;
+
+   {
+      std::lock_guard<std::mutex> lock(StopLock);
+      StopWatching = true;
+   }
+   Stopped.notify_all();
+   Watcher.join();
+}
+
+ShaderFileWatcher::WriteTimes ShaderFileWatcher::getWriteTimes(const std::string& directory_path)
+{
+   // A file can be replaced while the directory is listed, so errors only drop that file from this poll.
+   WriteTimes write_times;
+   std::error_code error;
+   for (std::filesystem::directory_iterator it(directory_path, error), end; !error && it != end; it.increment( error )) {
+      std::error_code file_error;
+      if (!it->is_regular_file( file_error )) continue;
+
+      const auto write_time = it->last_write_time( file_error );
+      if (!file_error) write_times[it->path().string()] = write_time;
+   }
+   return write_times;
+}
+
+void ShaderFileWatcher::watch(const std::string& directory_path, std::chrono::milliseconds interval)
+{
+   WriteTimes reported = getWriteTimes( directory_path );
+   WriteTimes previous = reported;
+   while (true) {
+      {
+         std::unique_lock<std::mutex> lock(StopLock);
+         if (Stopped.wait_for( lock, interval, [this]() { return StopWatching; } )) return;
+      }
+
+      WriteTimes current = getWriteTimes( directory_path );
+      if (current == previous && current != reported) {
+         reported = current;
+         IsChanged.store( true, std::memory_order_release );
+      }
+      previous = std::move( current );
+   }
+}
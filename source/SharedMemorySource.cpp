@@ -0,0 +1,161 @@
+#include "SharedMemorySource.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+SharedMemorySource::SharedMemorySource() :
+   FrameSource( static_cast<int>(SharedFrameRing::SlotNum) ), Ring( nullptr ), MappingSize( 0 ), LatencySumInNs( 0 ),
+   MaxLatencyInNs( 0 ), MeasuredFrameNum( 0 )
+{
+}
+
+SharedMemorySource::~SharedMemorySource()
+{
+   close();
+}
+
+#ifdef _WIN32
+bool SharedMemorySource::open(const std::string& /*name*/, cv::Mat& /*first_frame*/, bool /*use_planar_yuv*/)
+{
+   std::cout << "Shared-memory frame input is only supported with POSIX shared memory...\n";
+   return false;
+}
+
+void SharedMemorySource::close()
+{
+   FrameSource::close();
+}
+#else
+// The producer chooses the pixel format, so use_planar_yuv is not applied.
+bool SharedMemorySource::open(const std::string& name, cv::Mat& first_frame, bool /*use_planar_yuv*/)
+{
+   close();
+
+   const int descriptor = shm_open( name.c_str(), O_RDWR, 0 );
+   if (descriptor < 0) {
+      std::cout << "Cannot Open Shared Memory " << name << "...\n";
+      return false;
+   }
+
+   struct stat status{};
+   void* mapping = MAP_FAILED;
+   if (fstat( descriptor, &status ) == 0 && static_cast<size_t>(status.st_size) >= sizeof(SharedFrameRing::Header)) {
+      mapping = mmap( nullptr, static_cast<size_t>(status.st_size), PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0 );
+   }
+   ::close( descriptor );
+   if (mapping == MAP_FAILED) {
+      std::cout << "Cannot Map Shared Memory " << name << "...\n";
+      return false;
+   }
+
+   Ring = static_cast<SharedFrameRing::Header*>(mapping);
+   MappingSize = static_cast<size_t>(status.st_size);
+   const bool is_valid = Ring->Magic == SharedFrameRing::Magic && Ring->Version == SharedFrameRing::Version &&
+      Ring->SlotNum == SharedFrameRing::SlotNum && Ring->Format <= SharedFrameRing::NV12 &&
+      Ring->Width % 2 == 0 && Ring->Height % 2 == 0 &&
+      Ring->SlotSize >= SharedFrameRing::getFrameSize( Ring->Width, Ring->Height, Ring->Format ) &&
+      Ring->DataOffset + Ring->SlotSize * Ring->SlotNum <= MappingSize;
+   if (!is_valid) {
+      std::cout << "Shared Memory " << name << " does not hold a frame ring...\n";
+      close();
+      return false;
+   }
+
+   Clip.Format = static_cast<PixelFormat>(Ring->Format);
+   Clip.Width = static_cast<int>(Ring->Width);
+   Clip.Height = static_cast<int>(Ring->Height);
+   Clip.FPS = Ring->FPS > 0.0 ? Ring->FPS : 60.0;
+   Clip.FirstFrameTime = 0.0;
+   Clip.FrameCount = 0;
+
+   // Every ring slot is a header on its shared slot. start() keeps them because they already have the frame layout.
+   const int rows = Clip.Format == BGR ? Clip.Height : Clip.Height * 3 / 2;
+   const int type = Clip.Format == BGR ? CV_8UC3 : CV_8UC1;
+   auto* data = static_cast<uint8_t*>(mapping) + Ring->DataOffset;
+   for (size_t i = 0; i < Frames.size(); ++i) Frames[i] = cv::Mat(rows, Clip.Width, type, data + i * Ring->SlotSize);
+
+   // Frames the producer published before we attached are stale, so they are handed back at once.
+   first_frame.create( rows, Clip.Width, type );
+   if (Clip.Format == BGR) first_frame.setTo( 0 );
+   else {
+      first_frame.rowRange( 0, Clip.Height ).setTo( 16 );
+      first_frame.rowRange( Clip.Height, rows ).setTo( 128 );
+   }
+   const uint64_t sequence = Ring->WriteSequence.load( std::memory_order_acquire );
+   Ring->ReadSequence.store( sequence, std::memory_order_release );
+   LatencySumInNs.store( 0, std::memory_order_relaxed );
+   MaxLatencyInNs.store( 0, std::memory_order_relaxed );
+   MeasuredFrameNum.store( 0, std::memory_order_relaxed );
+   start( first_frame, sequence );
+   return true;
+}
+
+void SharedMemorySource::close()
+{
+   FrameSource::close();
+   if (Ring != nullptr) {
+      for (auto& frame : Frames) frame.release();
+      munmap( Ring, MappingSize );
+      Ring = nullptr;
+      MappingSize = 0;
+   }
+}
+#endif
+
+void SharedMemorySource::decode()
+{
+   // The ring indices of FrameSource are the sequence numbers of the shared ring, so no slot is remapped.
+   // This thread only mirrors the producer's WriteSequence into WriteIndex and ReadIndex back into ReadSequence.
+   uint32_t epoch = 0;
+   int frame_index = 0;
+   uint64_t released_index = ReadIndex.load( std::memory_order_acquire );
+   while (!StopDecoding.load( std::memory_order_acquire )) {
+      while (takeSeekRequest( epoch, frame_index )) {}
+
+      const uint64_t read_index = ReadIndex.load( std::memory_order_acquire );
+      if (read_index != released_index) {
+         // The last released slot is the one which was uploaded; the others were skipped as late.
+         const SharedFrameRing::SlotHeader& slot = Ring->Slots[(read_index - 1) % SharedFrameRing::SlotNum];
+         const int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()
+         ).count();
+         const int64_t latency = now - slot.PublishedTimeInNs;
+         LatencySumInNs.fetch_add( static_cast<uint64_t>(std::max<int64_t>( latency, 0 )), std::memory_order_relaxed );
+         MaxLatencyInNs.store( std::max( MaxLatencyInNs.load( std::memory_order_relaxed ), latency ), std::memory_order_relaxed );
+         MeasuredFrameNum.fetch_add( 1, std::memory_order_relaxed );
+         Ring->ReadSequence.store( read_index, std::memory_order_release );
+         released_index = read_index;
+      }
+
+      const uint64_t published = Ring->WriteSequence.load( std::memory_order_acquire );
+      uint64_t write_index = WriteIndex.load( std::memory_order_relaxed );
+      if (write_index == published) {
+         EndOfStream.store( Ring->IsProducing.load( std::memory_order_acquire ) == 0, std::memory_order_release );
+         std::this_thread::sleep_for( std::chrono::microseconds(200) );
+         continue;
+      }
+      for (; write_index < published && !isRingFull( write_index ); ++write_index) {
+         DecodedFrameNum.fetch_add( 1, std::memory_order_relaxed );
+         commitFrame( write_index, 0.0, 0.0, epoch );
+      }
+   }
+}
+
+void SharedMemorySource::printStatistics() const
+{
+   FrameSource::printStatistics();
+   const uint64_t measured = MeasuredFrameNum.load( std::memory_order_relaxed );
+   if (measured > 0) {
+      std::cout << " - Publish-to-Upload Latency: "
+         << static_cast<double>(LatencySumInNs.load( std::memory_order_relaxed )) / static_cast<double>(measured) * 1e-6
+         << " ms on average, " << static_cast<double>(MaxLatencyInNs.load( std::memory_order_relaxed )) * 1e-6
+         << " ms at most\n";
+   }
+   if (Ring != nullptr) {
+      std::cout << " - Producer Drops (ring full): " << Ring->DroppedFrameNum.load( std::memory_order_relaxed ) << "\n";
+   }
+}
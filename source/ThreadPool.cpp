@@ -0,0 +1,31 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(int thread_num) : IsStopped( false )
+{
+   for (int i = 0; i < std::max( thread_num, 1 ); ++i) Workers.emplace_back( &ThreadPool::work, this );
+}
+
+ThreadPool::~ThreadPool()
+{
+   {
+      std::lock_guard<std::mutex> lock(JobLock);
+      IsStopped = true;
+   }
+   JobAdded.notify_all();
+   for (auto& worker : Workers) worker.join();
+}
+
+void ThreadPool::work()
+{
+   while (true) {
+      std::function<void()> job;
+      {
+         std::unique_lock<std::mutex> lock(JobLock);
+         JobAdded.wait( lock, [this]() { return IsStopped || !Jobs.empty(); } );
+         if (Jobs.empty()) return;
+         job = std::move( Jobs.front() );
+         Jobs.pop();
+      }
+      job();
+   }
+}
@@ -0,0 +1,117 @@
+#include "VertexCache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+
+std::vector<uint32_t> VertexCache::optimize(const std::vector<uint32_t>& indices, size_t vertex_num)
+{
+   constexpr int cache_size = 32;
+   const auto getVertexScore = [](int cache_position, uint32_t remaining_triangle_num)
+   {
+      if (remaining_triangle_num == 0) return -1.0f;
+
+      // The last triangle's vertices score the same, so the next triangle does not prefer any of them.
+      float score = 0.0f;
+      if (cache_position >= 0) {
+         if (cache_position < 3) score = 0.75f;
+         else {
+            const float scaler = 1.0f - static_cast<float>(cache_position - 3) / static_cast<float>(cache_size - 3);
+            score = std::pow( scaler, 1.5f );
+         }
+      }
+      // Vertices with few triangles left are finished first, so they do not linger as isolated triangles.
+      return score + 2.0f / std::sqrt( static_cast<float>(remaining_triangle_num) );
+   };
+
+   // The triangles of each vertex are kept in one array, and the remaining ones at the front of each range.
+   const size_t triangle_num = indices.size() / 3;
+   std::vector<uint32_t> remaining_triangle_nums(vertex_num, 0);
+   for (const uint32_t index : indices) remaining_triangle_nums[index]++;
+   std::vector<uint32_t> offsets(vertex_num + 1, 0);
+   for (size_t v = 0; v < vertex_num; ++v) offsets[v + 1] = offsets[v] + remaining_triangle_nums[v];
+   std::vector<uint32_t> vertex_triangles(indices.size());
+   std::vector<uint32_t> filled(vertex_num, 0);
+   for (size_t t = 0; t < triangle_num; ++t) {
+      for (size_t k = 0; k < 3; ++k) {
+         const uint32_t v = indices[t * 3 + k];
+         vertex_triangles[offsets[v] + filled[v]++] = static_cast<uint32_t>(t);
+      }
+   }
+
+   std::vector<int> cache_positions(vertex_num, -1);
+   std::vector<float> vertex_scores(vertex_num);
+   for (size_t v = 0; v < vertex_num; ++v) vertex_scores[v] = getVertexScore( -1, remaining_triangle_nums[v] );
+   std::vector<bool> is_emitted(triangle_num, false);
+   std::vector<uint32_t> cache, next_cache;
+   std::vector<uint32_t> optimized;
+   optimized.reserve( triangle_num * 3 );
+   size_t next_unemitted = 0;
+   int64_t best_triangle = -1;
+   for (size_t n = 0; n < triangle_num; ++n) {
+      if (best_triangle < 0) {
+         // Nothing in the cache connects to the rest, so the mesh continues at its next unemitted triangle.
+         while (is_emitted[next_unemitted]) next_unemitted++;
+         best_triangle = static_cast<int64_t>(next_unemitted);
+      }
+
+      const auto triangle = static_cast<size_t>(best_triangle);
+      is_emitted[triangle] = true;
+      next_cache.clear();
+      for (size_t k = 0; k < 3; ++k) {
+         const uint32_t v = indices[triangle * 3 + k];
+         optimized.emplace_back( v );
+         next_cache.emplace_back( v );
+
+         uint32_t* begin = vertex_triangles.data() + offsets[v];
+         uint32_t* end = begin + remaining_triangle_nums[v];
+         std::iter_swap( std::find( begin, end, static_cast<uint32_t>(triangle) ), end - 1 );
+         remaining_triangle_nums[v]--;
+      }
+      for (const uint32_t v : cache) {
+         if (std::find( next_cache.begin(), next_cache.begin() + 3, v ) == next_cache.begin() + 3) next_cache.emplace_back( v );
+      }
+
+      // The vertices pushed out of the cache are rescored too, as they lost their cache bonus.
+      for (size_t i = 0; i < next_cache.size(); ++i) {
+         const uint32_t v = next_cache[i];
+         cache_positions[v] = i < cache_size ? static_cast<int>(i) : -1;
+         vertex_scores[v] = getVertexScore( cache_positions[v], remaining_triangle_nums[v] );
+      }
+
+      best_triangle = -1;
+      float best_score = -1.0f;
+      for (size_t i = 0; i < next_cache.size() && i < cache_size; ++i) {
+         const uint32_t v = next_cache[i];
+         for (uint32_t j = 0; j < remaining_triangle_nums[v]; ++j) {
+            const uint32_t t = vertex_triangles[offsets[v] + j];
+            const float score = vertex_scores[indices[t * 3]] + vertex_scores[indices[t * 3 + 1]] +
+               vertex_scores[indices[t * 3 + 2]];
+            if (score > best_score) {
+               best_score = score;
+               best_triangle = t;
+            }
+         }
+      }
+      if (next_cache.size() > cache_size) next_cache.resize( cache_size );
+      cache.swap( next_cache );
+   }
+   return optimized;
+}
+
+float VertexCache::getAverageCacheMissRatio(const std::vector<uint32_t>& indices, size_t cache_size)
+{
+   const size_t triangle_num = indices.size() / 3;
+   if (triangle_num == 0 || cache_size == 0) return 0.0f;
+
+   std::deque<uint32_t> cache;
+   size_t miss_num = 0;
+   for (size_t i = 0; i < triangle_num * 3; ++i) {
+      if (std::find( cache.begin(), cache.end(), indices[i] ) != cache.end()) continue;
+
+      miss_num++;
+      cache.emplace_back( indices[i] );
+      if (cache.size() > cache_size) cache.pop_front();
+   }
+   return static_cast<float>(miss_num) / static_cast<float>(triangle_num);
+}
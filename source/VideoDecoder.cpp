@@ -0,0 +1,275 @@
+#include "VideoDecoder.h"
+
+VideoDecoder::VideoDecoder(int queue_size) :
+   FrameSource( queue_size ), UsePlanarYUV( false ), SwitchedClipNum( 0 ), CachedFrameNum( 0 ), CacheHitNum( 0 ),
+   CacheBudget( 0 ), Video( std::make_unique<cv::VideoCapture>() )
+{
+}
+
+VideoDecoder::~VideoDecoder()
+{
+   close();
+}
+
+bool VideoDecoder::openClip(
+   cv::VideoCapture& video,
+   const std::string& video_path,
+   cv::Mat& first_frame,
+   ClipInfo& clip,
+   bool use_planar_yuv
+)
+{
+   video.open( video_path );
+   if (!video.isOpened()) {
+      std::cout << "Cannot Read Video File...\n";
+      return false;
+   }
+
+   if (use_planar_yuv) video.set( cv::CAP_PROP_CONVERT_RGB, 0.0 );
+   video >> first_frame;
+   if (first_frame.empty()) {
+      video.release();
+      return false;
+   }
+
+   const double fps = video.get( cv::CAP_PROP_FPS );
+   clip.FPS = fps > 0.0 ? fps : 30.0;
+   clip.FirstFrameTime = std::max( video.get( cv::CAP_PROP_POS_MSEC ), 0.0 );
+   clip.FrameCount = static_cast<int>(video.get( cv::CAP_PROP_FRAME_COUNT ));
+   clip.Format = BGR;
+   clip.Width = first_frame.cols;
+   clip.Height = first_frame.rows;
+   if (use_planar_yuv) {
+      const auto width = static_cast<int>(video.get( cv::CAP_PROP_FRAME_WIDTH ));
+      const auto height = static_cast<int>(video.get( cv::CAP_PROP_FRAME_HEIGHT ));
+      const bool is_planar = first_frame.type() == CV_8UC1 && first_frame.cols == width &&
+         first_frame.rows == height * 3 / 2 && width % 2 == 0 && height % 2 == 0;
+      if (is_planar) {
+         const auto pixel_format = static_cast<int>(video.get( cv::CAP_PROP_CODEC_PIXEL_FORMAT ));
+         clip.Format = pixel_format == cv::VideoWriter::fourcc( 'N', 'V', '1', '2' ) ? NV12 : I420;
+         clip.Width = width;
+         clip.Height = height;
+      }
+      else if (first_frame.type() != CV_8UC3) {
+         std::cout << "The video backend does not provide planar YUV frames; falling back to BGR...\n";
+         video.release();
+         return openClip( video, video_path, first_frame, clip, false );
+      }
+   }
+   return true;
+}
+
+bool VideoDecoder::open(const std::string& video_path, cv::Mat& first_frame, bool use_planar_yuv)
+{
+   return open( std::vector<std::string>{ video_path }, first_frame, use_planar_yuv );
+}
+
+bool VideoDecoder::open(const std::vector<std::string>& playlist, cv::Mat& first_frame, bool use_planar_yuv)
+{
+   close();
+
+   if (playlist.empty() || !openClip( *Video, playlist[0], first_frame, Clip, use_planar_yuv )) return false;
+
+   Playlist = playlist;
+   KeyFrames.clear();
+   for (const auto& video_path : Playlist) {
+      KeyFrames.emplace_back( std::make_unique<KeyFrameIndex>() );
+      if (!KeyFrames.back()->build( video_path )) {
+         std::cout << "Cannot index the key frames of " << video_path << "; seeking is left to the video backend.\n";
+      }
+   }
+   UsePlanarYUV = Clip.Format != BGR;
+   SwitchedClipNum.store( 0, std::memory_order_relaxed );
+   CacheHitNum.store( 0, std::memory_order_relaxed );
+   Cache.clear();
+   Cache.setBudget( CacheBudget );
+   Cache.insert( 0, 0, first_frame, Clip.FirstFrameTime );
+   CachedFrameNum.store( Cache.getFrameNum(), std::memory_order_relaxed );
+   start( first_frame );
+   return true;
+}
+
+void VideoDecoder::close()
+{
+   FrameSource::close();
+   if (Video->isOpened()) Video->release();
+}
+
+bool VideoDecoder::hasNextClip(size_t clip_index) const
+{
+   return clip_index + 1 < Playlist.size() || IsLooping.load( std::memory_order_acquire );
+}
+
+bool VideoDecoder::seekCapture(size_t clip_index, int& video_frame_index, int frame_index)
+{
+   // Decoding forward is cheaper than a seek as long as no key frame lies between the current and requested frames.
+   const int key_frame = KeyFrames[clip_index]->getPrecedingKeyFrame( frame_index );
+   if (key_frame < 0) {
+      Video->set( cv::CAP_PROP_POS_FRAMES, static_cast<double>(frame_index) );
+      video_frame_index = frame_index;
+      return true;
+   }
+   if (frame_index < video_frame_index || key_frame > video_frame_index) {
+      Video->set( cv::CAP_PROP_POS_FRAMES, static_cast<double>(key_frame) );
+      video_frame_index = key_frame;
+   }
+   while (video_frame_index < frame_index && Video->grab()) video_frame_index++;
+   return video_frame_index == frame_index;
+}
+
+void VideoDecoder::decode()
+{
+   const auto queue_size = static_cast<uint64_t>(QueueSize);
+   std::vector<ClipInfo> clips(Playlist.size());
+   std::vector<bool> is_clip_opened(Playlist.size(), false);
+   clips[0] = Clip;
+   is_clip_opened[0] = true;
+   size_t clip_index = 0; // clip of the next frame on the timeline
+   size_t video_clip_index = 0; // clip which the capture is opened on
+   int clip_frame_index = 1; // next frame on the timeline
+   int video_frame_index = 1; // frame which the capture decodes next
+   double frame_interval = 1000.0 / Clip.FPS;
+   double timeline_offset = 0.0;
+   double previous_timestamp = Clip.FirstFrameTime;
+   uint32_t epoch = 0;
+   std::unique_ptr<Preroll> preroll;
+   std::future<bool> preroll_result;
+   const auto discard_preroll = [&preroll, &preroll_result]()
+   {
+      // The pre-roll task writes into the Preroll, so it has to finish before the Preroll is freed.
+      if (preroll_result.valid()) preroll_result.wait();
+      preroll_result = std::future<bool>();
+      preroll.reset();
+   };
+   while (!StopDecoding.load( std::memory_order_acquire )) {
+      if (takeSeekRequest( epoch, clip_frame_index )) {
+         // The capture is only repositioned if the requested frames are not cached. Then it decodes forward from
+         // the preceding key frame to the requested frame, reusing the opened decoder.
+         clip_frame_index = clips[clip_index].clampFrameIndex( clip_frame_index );
+         timeline_offset = 0.0;
+         previous_timestamp = clips[clip_index].getFrameTime( clip_frame_index ) - frame_interval;
+      }
+      if (EndOfStream.load( std::memory_order_acquire )) {
+         std::this_thread::sleep_for( std::chrono::milliseconds(1) );
+         continue;
+      }
+
+      const uint64_t write_index = WriteIndex.load( std::memory_order_relaxed );
+      if (isRingFull( write_index )) {
+         if (!waitForFreeSlot( write_index )) break;
+         continue;
+      }
+
+      // The next clip is pre-rolled about a second before the end, or right away if the length is unknown.
+      // It is not needed when its first frame is still cached.
+      const ClipInfo& clip = clips[clip_index];
+      const size_t next_clip_index = (clip_index + 1) % Playlist.size();
+      const bool is_next_clip_cached = is_clip_opened[next_clip_index] && Cache.contains( next_clip_index, 0 );
+      const int preroll_frame_num = std::max( static_cast<int>(clip.FPS), QueueSize * 2 );
+      if (!preroll_result.valid() && !is_next_clip_cached && hasNextClip( clip_index ) &&
+          (clip.FrameCount <= 0 || clip_frame_index + preroll_frame_num >= clip.FrameCount)) {
+         preroll = std::make_unique<Preroll>();
+         preroll->Video = std::make_unique<cv::VideoCapture>();
+         preroll_result = std::async(
+            std::launch::async,
+            [next = preroll.get(), path = Playlist[next_clip_index], yuv = UsePlanarYUV]()
+            {
+               return openClip( *next->Video, path, next->FirstFrame, next->Clip, yuv );
+            }
+         );
+      }
+
+      // The slot is free once the render thread has moved ReadIndex past it, so it is safe to decode in place.
+      cv::Mat& frame = Frames[write_index % queue_size];
+      double clip_timestamp = 0.0;
+      bool is_decoded = false;
+      bool has_frame = clip.FrameCount <= 0 || clip_frame_index < clip.FrameCount;
+      if (has_frame && Cache.find( clip_index, clip_frame_index, frame, clip_timestamp )) {
+         CacheHitNum.fetch_add( 1, std::memory_order_relaxed );
+      }
+      else if (has_frame) {
+         const auto decode_start_time = std::chrono::steady_clock::now();
+         if (video_clip_index != clip_index) {
+            // The capture has already moved on to the next clip, and this clip was evicted from the cache.
+            cv::Mat first_frame;
+            ClipInfo reopened;
+            has_frame = openClip( *Video, Playlist[clip_index], first_frame, reopened, UsePlanarYUV );
+            video_clip_index = clip_index;
+            video_frame_index = 1;
+         }
+         if (has_frame && video_frame_index != clip_frame_index) {
+            has_frame = seekCapture( clip_index, video_frame_index, clip_frame_index );
+         }
+         has_frame = has_frame && Video->read( frame ) && !frame.empty();
+         if (has_frame) {
+            clip_timestamp = Video->get( cv::CAP_PROP_POS_MSEC );
+            video_frame_index = clip_frame_index + 1;
+            is_decoded = true;
+            addDecodeTime( std::chrono::steady_clock::now() - decode_start_time );
+         }
+      }
+
+      if (!has_frame) {
+         if (!hasNextClip( clip_index )) {
+            discard_preroll();
+            EndOfStream.store( true, std::memory_order_release );
+            continue;
+         }
+
+         if (is_next_clip_cached && Cache.find( next_clip_index, 0, frame, clip_timestamp )) {
+            CacheHitNum.fetch_add( 1, std::memory_order_relaxed );
+         }
+         else {
+            const bool switchable = preroll_result.valid() && preroll_result.get() &&
+               preroll->FirstFrame.size() == frame.size() && preroll->FirstFrame.type() == frame.type();
+            if (!switchable) {
+               if (preroll != nullptr && preroll->Video->isOpened()) {
+                  std::cout << "The next clip cannot be played gaplessly; it does not match the current frame layout.\n";
+               }
+               discard_preroll();
+               EndOfStream.store( true, std::memory_order_release );
+               continue;
+            }
+
+            Video.swap( preroll->Video );
+            preroll->FirstFrame.copyTo( frame );
+            clip_timestamp = preroll->Clip.FirstFrameTime;
+            clips[next_clip_index] = preroll->Clip;
+            is_clip_opened[next_clip_index] = true;
+            video_clip_index = next_clip_index;
+            video_frame_index = 1;
+            is_decoded = true;
+         }
+         discard_preroll();
+
+         // The first frame of the next clip goes right after the last frame of the current one on the timeline.
+         clip_index = next_clip_index;
+         clip_frame_index = 0;
+         frame_interval = 1000.0 / clips[clip_index].FPS;
+         timeline_offset = previous_timestamp + frame_interval - clip_timestamp;
+         SwitchedClipNum.fetch_add( 1, std::memory_order_relaxed );
+      }
+
+      // Some backends do not report a usable position, so the timestamp is extrapolated from the frame rate then.
+      double timestamp = timeline_offset + clip_timestamp;
+      if (timestamp <= previous_timestamp) timestamp = previous_timestamp + frame_interval;
+      if (is_decoded) {
+         Cache.insert( clip_index, clip_frame_index, frame, timestamp - timeline_offset );
+         CachedFrameNum.store( Cache.getFrameNum(), std::memory_order_relaxed );
+      }
+      clip_frame_index++;
+
+      previous_timestamp = timestamp;
+      if (is_decoded) DecodedFrameNum.fetch_add( 1, std::memory_order_relaxed );
+      commitFrame( write_index, timestamp, timeline_offset, epoch );
+   }
+   discard_preroll();
+}
+
+void VideoDecoder::printStatistics() const
+{
+   FrameSource::printStatistics();
+   std::cout << " - Gapless Clip Switches: " << getSwitchedClipNum() << "\n";
+   std::cout << " - Cache Hits: " << getCacheHitNum() << " (" << getCachedFrameNum() << " frames cached, "
+      << CacheBudget / (1024 * 1024) << " MiB budget)\n";
+}
@@ -0,0 +1,164 @@
+/*
+ * Publishes a moving test pattern into a SharedFrameRing, so that SlideProjector can project live frames
+ * from another process. It reports the throughput and how far the projector lags behind once a second.
+ *
+ * usage: SharedMemoryProducer [name=/SlideProjector] [width=1920] [height=1080] [fps=60] [bgr|i420|nv12] [seconds=0]
+ */
+
+#include "SharedFrameRing.h"
+
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace
+{
+   volatile std::sig_atomic_t IsInterrupted = 0;
+
+   void interrupt(int) { IsInterrupted = 1; }
+
+   int64_t getTimeInNs()
+   {
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(
+         std::chrono::steady_clock::now().time_since_epoch()
+      ).count();
+   }
+
+   // A vertical bar sweeps across a gradient, so dropped or repeated frames are visible on the projection.
+   void drawPattern(uint8_t* data, uint32_t width, uint32_t height, uint32_t format, uint64_t sequence)
+   {
+      const uint32_t bar = static_cast<uint32_t>(sequence * 8 % width);
+      if (format == SharedFrameRing::BGR) {
+         for (uint32_t y = 0; y < height; ++y) {
+            uint8_t* row = data + static_cast<size_t>(y) * width * 3;
+            for (uint32_t x = 0; x < width; ++x) {
+               const bool is_bar = x >= bar && x < bar + 16;
+               row[x * 3] = is_bar ? 255 : static_cast<uint8_t>(x * 255 / width);
+               row[x * 3 + 1] = is_bar ? 255 : static_cast<uint8_t>(y * 255 / height);
+               row[x * 3 + 2] = is_bar ? 255 : static_cast<uint8_t>(sequence);
+            }
+         }
+         return;
+      }
+
+      for (uint32_t y = 0; y < height; ++y) {
+         uint8_t* row = data + static_cast<size_t>(y) * width;
+         for (uint32_t x = 0; x < width; ++x) {
+            row[x] = x >= bar && x < bar + 16 ? 235 : static_cast<uint8_t>(16 + x * 219 / width);
+         }
+      }
+      const size_t luma_size = static_cast<size_t>(width) * height;
+      const size_t chroma_size = luma_size / 4;
+      std::memset( data + luma_size, static_cast<int>(sequence & 0xFF), chroma_size );
+      std::memset( data + luma_size + chroma_size, 128, chroma_size );
+   }
+}
+
+int main(int argc, char** argv)
+{
+   const std::string name = argc > 1 ? argv[1] : "/SlideProjector";
+   const auto width = static_cast<uint32_t>(argc > 2 ? std::stoul( argv[2] ) : 1920) & ~1u;
+   const auto height = static_cast<uint32_t>(argc > 3 ? std::stoul( argv[3] ) : 1080) & ~1u;
+   const double fps = argc > 4 ? std::stod( argv[4] ) : 60.0;
+   const std::string format_name = argc > 5 ? argv[5] : "bgr";
+   const double duration_in_sec = argc > 6 ? std::stod( argv[6] ) : 0.0;
+   const uint32_t format = format_name == "i420" ? SharedFrameRing::I420 :
+                           format_name == "nv12" ? SharedFrameRing::NV12 : SharedFrameRing::BGR;
+   if (width == 0 || height == 0 || fps <= 0.0) {
+      std::cout << "usage: " << argv[0] << " [name] [width] [height] [fps] [bgr|i420|nv12] [seconds]\n";
+      return 1;
+   }
+
+   const size_t frame_size = SharedFrameRing::getFrameSize( width, height, format );
+   const size_t mapping_size = SharedFrameRing::getMappingSize( width, height, format );
+   shm_unlink( name.c_str() );
+   const int descriptor = shm_open( name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600 );
+   if (descriptor < 0 || ftruncate( descriptor, static_cast<off_t>(mapping_size) ) != 0) {
+      std::cout << "Cannot Create Shared Memory " << name << "...\n";
+      return 1;
+   }
+   void* mapping = mmap( nullptr, mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0 );
+   close( descriptor );
+   if (mapping == MAP_FAILED) {
+      std::cout << "Cannot Map Shared Memory " << name << "...\n";
+      shm_unlink( name.c_str() );
+      return 1;
+   }
+
+   auto* ring = new (mapping) SharedFrameRing::Header{};
+   ring->Width = width;
+   ring->Height = height;
+   ring->Format = format;
+   ring->SlotNum = SharedFrameRing::SlotNum;
+   ring->SlotSize = SharedFrameRing::alignToPage( frame_size );
+   ring->DataOffset = SharedFrameRing::alignToPage( sizeof(SharedFrameRing::Header) );
+   ring->FPS = fps;
+   ring->Version = SharedFrameRing::Version;
+   ring->IsProducing.store( 1, std::memory_order_relaxed );
+   // The magic number goes last, so a consumer never sees a half-initialized header.
+   std::atomic_thread_fence( std::memory_order_release );
+   ring->Magic = SharedFrameRing::Magic;
+
+   std::signal( SIGINT, interrupt );
+   std::signal( SIGTERM, interrupt );
+   std::cout << "Publishing " << width << "x" << height << " " << format_name << " frames at " << fps << " fps into "
+      << name << " (" << mapping_size / (1024 * 1024) << " MiB)\n";
+
+   auto* slots = static_cast<uint8_t*>(mapping) + ring->DataOffset;
+   const auto frame_interval = std::chrono::nanoseconds(static_cast<int64_t>(1e9 / fps));
+   const auto start_time = std::chrono::steady_clock::now();
+   auto next_time = start_time;
+   auto report_time = start_time + std::chrono::seconds(1);
+   uint64_t published_num = 0, reported_num = 0, reported_drops = 0;
+   int64_t draw_time_sum = 0;
+   while (IsInterrupted == 0) {
+      std::this_thread::sleep_until( next_time );
+      next_time += frame_interval;
+
+      const uint64_t sequence = ring->WriteSequence.load( std::memory_order_relaxed );
+      if (sequence - ring->ReadSequence.load( std::memory_order_acquire ) >= SharedFrameRing::SlotNum) {
+         ring->DroppedFrameNum.fetch_add( 1, std::memory_order_relaxed );
+      }
+      else {
+         const int64_t draw_start = getTimeInNs();
+         drawPattern( slots + (sequence % SharedFrameRing::SlotNum) * ring->SlotSize, width, height, format, sequence );
+         SharedFrameRing::SlotHeader& slot = ring->Slots[sequence % SharedFrameRing::SlotNum];
+         slot.Sequence = sequence;
+         slot.PublishedTimeInNs = getTimeInNs();
+         draw_time_sum += slot.PublishedTimeInNs - draw_start;
+         ring->WriteSequence.store( sequence + 1, std::memory_order_release );
+         published_num++;
+      }
+
+      const auto now = std::chrono::steady_clock::now();
+      if (now >= report_time) {
+         const uint64_t frames = published_num - reported_num;
+         const uint64_t drops = ring->DroppedFrameNum.load( std::memory_order_relaxed );
+         std::cout << " - " << frames << " fps, " << static_cast<double>(frames * frame_size) / (1024.0 * 1024.0)
+            << " MiB/s, " << (frames > 0 ? static_cast<double>(draw_time_sum) / static_cast<double>(frames) * 1e-6 : 0.0)
+            << " ms to draw, " << drops - reported_drops << " dropped (ring full), projector "
+            << ring->WriteSequence.load( std::memory_order_relaxed ) - ring->ReadSequence.load( std::memory_order_relaxed )
+            << " frames behind\n";
+         reported_num = published_num;
+         reported_drops = drops;
+         draw_time_sum = 0;
+         report_time += std::chrono::seconds(1);
+      }
+      if (duration_in_sec > 0.0 && now - start_time >= std::chrono::duration<double>(duration_in_sec)) break;
+   }
+
+   ring->IsProducing.store( 0, std::memory_order_release );
+   std::cout << "Published " << published_num << " frames, dropped "
+      << ring->DroppedFrameNum.load( std::memory_order_relaxed ) << "\n";
+   munmap( mapping, mapping_size );
+   shm_unlink( name.c_str() );
+   return 0;
+}
@@ -0,0 +1,39 @@
+/*
+ * Renders a scripted scenario of SlideProjector without any input and reports the timings as JSON.
+ * The main camera and the projector follow a fixed path and the slide advances one frame per rendered frame,
+ * so two runs on the same machine render the same frames and their reports can be compared.
+ *
+ * --upload legacy uploads BGR slides the way they were before the streaming path, so both can be measured on
+ * the same machine.
+ *
+ * usage: SlideProjectorBench [--report PATH] [--slide generated|image|video|sequence] [--headless] [--size WxH]
+ *                            [--frames N=300] [--mesh PATH] [--upload streaming|legacy]
+ */
+
+#include "Renderer.h"
+
+int main(int argc, char** argv)
+{
+   // The generated slide, the upload path and the report are only known to the benchmark;
+   // the rest is parsed like SlideProjector.
+   std::string report_path;
+   bool use_generated_slide = false;
+   bool use_legacy_upload = false;
+   std::vector<char*> arguments{ argv[0] };
+   for (int i = 1; i < argc; ++i) {
+      const std::string argument = argv[i];
+      if (argument == "--report" && i + 1 < argc) report_path = argv[++i];
+      else if (argument == "--slide" && i + 1 < argc && std::string(argv[i + 1]) == "generated") {
+         use_generated_slide = true;
+         ++i;
+      }
+      else if (argument == "--upload" && i + 1 < argc) use_legacy_upload = std::string(argv[++i]) == "legacy";
+      else arguments.emplace_back( argv[i] );
+   }
+
+   RendererGL::Options options;
+   if (!RendererGL::parseArguments( static_cast<int>(arguments.size()), arguments.data(), options )) return 1;
+
+   RendererGL renderer( options );
+   return renderer.benchmark( report_path, use_generated_slide, use_legacy_upload ) ? 0 : 1;
+}
@@ -0,0 +1,57 @@
+/*
+ * Measures the average cache miss ratio (ACMR) of the vertex cache optimization on a grid whose triangles are
+ * shuffled, and fails if the optimized order misses the cache more often than the shuffled one.
+ * The shuffle uses a fixed seed, so two runs print the same ratios.
+ *
+ * usage: VertexCacheCheck [grid=100] [seed=1]
+ */
+
+#include "VertexCache.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <random>
+
+int main(int argc, char** argv)
+{
+   const int grid = argc > 1 ? std::max( std::atoi( argv[1] ), 2 ) : 100;
+   const auto seed = static_cast<uint32_t>(argc > 2 ? std::atoi( argv[2] ) : 1);
+
+   // A grid of grid x grid vertices, split into two triangles per cell.
+   std::vector<uint32_t> ordered;
+   for (int y = 0; y + 1 < grid; ++y) {
+      for (int x = 0; x + 1 < grid; ++x) {
+         const auto v = static_cast<uint32_t>(y * grid + x);
+         const auto row = static_cast<uint32_t>(grid);
+         ordered.insert( ordered.end(), { v, v + row, v + 1, v + 1, v + row, v + row + 1 } );
+      }
+   }
+
+   const size_t triangle_num = ordered.size() / 3;
+   std::vector<size_t> triangles(triangle_num);
+   std::iota( triangles.begin(), triangles.end(), 0 );
+   std::shuffle( triangles.begin(), triangles.end(), std::mt19937(seed) );
+   std::vector<uint32_t> shuffled;
+   shuffled.reserve( ordered.size() );
+   for (const size_t t : triangles) shuffled.insert( shuffled.end(), ordered.begin() + t * 3, ordered.begin() + t * 3 + 3 );
+
+   const size_t vertex_num = static_cast<size_t>(grid) * grid;
+   const std::vector<uint32_t> optimized = VertexCache::optimize( shuffled, vertex_num );
+
+   bool is_improved = true;
+   std::cout << std::fixed << std::setprecision( 3 )
+      << grid << "x" << grid << " grid, " << triangle_num << " triangles\n";
+   for (const size_t cache_size : { 16, 32 }) {
+      const float shuffled_ratio = VertexCache::getAverageCacheMissRatio( shuffled, cache_size );
+      const float optimized_ratio = VertexCache::getAverageCacheMissRatio( optimized, cache_size );
+      std::cout << "FIFO cache of " << cache_size << ": ordered "
+         << VertexCache::getAverageCacheMissRatio( ordered, cache_size )
+         << ", shuffled " << shuffled_ratio << ", optimized " << optimized_ratio << " misses per triangle\n";
+      is_improved = is_improved && optimized_ratio < shuffled_ratio;
+   }
+   if (!is_improved) std::cout << "The optimized order does not miss the cache less than the shuffled one.\n";
+   return is_improved ? 0 : 1;
+}